@@ -0,0 +1,131 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <malloc.h>
+#include "include/alloc_stats.hpp"
+
+#ifdef ALLOC_STATS
+
+/* relaxed, since they are only read between phases */
+std::atomic<size_t> num_allocations(0), num_bytes(0), live_bytes(0), peak_live_bytes(0);
+
+void raise_peak_live_bytes(size_t live)
+{
+    size_t peak = peak_live_bytes.load(std::memory_order_relaxed);
+    while (live > peak && !peak_live_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+        ;
+}
+
+void *counted_malloc(size_t size)
+{
+    void *ptr = std::malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr)
+        return nullptr;
+    const size_t usable = malloc_usable_size(ptr);
+    num_allocations.fetch_add(1, std::memory_order_relaxed);
+    num_bytes.fetch_add(usable, std::memory_order_relaxed);
+    raise_peak_live_bytes(live_bytes.fetch_add(usable, std::memory_order_relaxed) + usable);
+    return ptr;
+}
+
+void counted_free(void *ptr)
+{
+    if (ptr == nullptr)
+        return;
+    live_bytes.fetch_sub(malloc_usable_size(ptr), std::memory_order_relaxed);
+    std::free(ptr);
+}
+
+void *operator new(size_t size)
+{
+    void *ptr = counted_malloc(size);
+    if (ptr == nullptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    return counted_malloc(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    return counted_malloc(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    counted_free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    counted_free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    counted_free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+    counted_free(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept
+{
+    counted_free(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept
+{
+    counted_free(ptr);
+}
+
+alloc_stats_t alloc_stats(void)
+{
+    return {
+        num_allocations.load(std::memory_order_relaxed),
+        num_bytes.load(std::memory_order_relaxed),
+        live_bytes.load(std::memory_order_relaxed),
+        peak_live_bytes.load(std::memory_order_relaxed)
+    };
+}
+
+size_t begin_peak_live_bytes(void)
+{
+    return peak_live_bytes.exchange(live_bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+size_t end_peak_live_bytes(size_t outer_peak)
+{
+    const size_t peak = peak_live_bytes.load(std::memory_order_relaxed);
+    raise_peak_live_bytes(outer_peak);
+    return peak;
+}
+
+#else
+
+alloc_stats_t alloc_stats(void)
+{
+    return { 0, 0, 0, 0 };
+}
+
+size_t begin_peak_live_bytes(void)
+{
+    return 0;
+}
+
+size_t end_peak_live_bytes(size_t)
+{
+    return 0;
+}
+
+#endif // ALLOC_STATS
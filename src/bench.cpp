@@ -0,0 +1,385 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "include/sampling.hpp"
+#include "include/decompose.hpp"
+#include "include/rectangular_dual.hpp"
+#include "include/port_assignment.hpp"
+#include "include/io.hpp"
+
+enum phase_t : unsigned
+{
+    READ, TRIANGLES, DECOMPOSE, ADD_X, RECT_DUAL, FIX_RECT_DUAL, VIRTUAL_EDGES, PORT_ASSIGNMENT, TOPOSORT, NUM_PHASES
+};
+const char *const phase_name[NUM_PHASES] = {
+    "read_graph", "list_separating_triangles", "build_four_block_tree", "add_x",
+    "compute_rect_dual", "fix_rectangular_dual", "add_virtual_edges", "port_assignment", "toposort_dags"
+};
+
+typedef std::chrono::steady_clock::time_point time_point_t;
+
+/* the benchmark graphs can always be drawn */
+void check(status_t status)
+{
+    if (status != status_t::OK)
+    {
+        std::cerr << error_message() << ". Exiting." << std::endl;
+        exit(1);
+    }
+}
+
+double seconds_since(time_point_t begin)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+/* Draws the graph given in the text format once, timing each phase on its
+ * own.  The steps of construct_drawing are summed over all components. */
+void run(const std::string &text, double *out_seconds)
+{
+    time_point_t begin = std::chrono::steady_clock::now();
+    std::istringstream is(text);
+    graph_t graph;
+    check(read_graph(is, graph));
+    out_seconds[READ] = seconds_since(begin);
+
+    begin = std::chrono::steady_clock::now();
+    const std::vector<triangle_t> triangles = list_separating_triangles(graph);
+    out_seconds[TRIANGLES] = seconds_since(begin);
+
+    begin = std::chrono::steady_clock::now();
+    four_block_tree_t four_block_tree;
+    check(build_four_block_tree(graph, four_block_tree));
+    out_seconds[DECOMPOSE] = seconds_since(begin);
+
+    drawing_buffers_t buffers;
+    buffers.pa.assign(graph.num_edges() + 1, 0b00);
+    port_assignment_t *pa = buffers.pa.data();
+    port_assignment_of_outer_face(four_block_tree.front(), pa);
+    drawing_counts_t counts{};
+    for (unsigned phase = ADD_X; phase <= PORT_ASSIGNMENT; ++phase)
+        out_seconds[phase] = 0;
+    for (auto &component : four_block_tree)
+    {
+        begin = std::chrono::steady_clock::now();
+        outer_face_t of;
+        check(add_x(component, pa, graph.num_edges(), of));
+        out_seconds[ADD_X] += seconds_since(begin);
+
+        begin = std::chrono::steady_clock::now();
+        rectangular_dual_t &rect_dual = buffers.rect_dual;
+        check(compute_rect_dual(component, rect_dual));
+        out_seconds[RECT_DUAL] += seconds_since(begin);
+
+        begin = std::chrono::steady_clock::now();
+        fix_rectangular_dual(component, rect_dual, of);
+        out_seconds[FIX_RECT_DUAL] += seconds_since(begin);
+
+        begin = std::chrono::steady_clock::now();
+        add_virtual_edges(component, rect_dual, graph.num_edges());
+        out_seconds[VIRTUAL_EDGES] += seconds_since(begin);
+
+        begin = std::chrono::steady_clock::now();
+        port_assignment(component, rect_dual, pa, 1, counts);
+        out_seconds[PORT_ASSIGNMENT] += seconds_since(begin);
+    }
+
+    buffers.x_coords.resize(graph.num_vertices());
+    buffers.y_coords.resize(graph.num_vertices());
+    begin = std::chrono::steady_clock::now();
+    check(toposort_dags(graph, pa, buffers.x_coords.data(), buffers.y_coords.data(), 1, false, buffers));
+    out_seconds[TOPOSORT] = seconds_since(begin);
+}
+
+/* the times of one phase at one size, sorted */
+struct result_t {
+    std::string phase;
+    size_t vertices;
+    std::vector<double> seconds;
+
+    double median() const
+    {
+        const size_t r = seconds.size();
+        return r % 2 ? seconds[r / 2] : (seconds[r / 2 - 1] + seconds[r / 2]) / 2;
+    }
+    double p95() const { return seconds[size_t(std::ceil(0.95 * seconds.size())) - 1]; }
+};
+
+/* Results are saved with every single time, as the comparison needs them,
+ * behind a line with the version of the format and the seed. */
+const int results_version = 1;
+
+void save_results(std::ostream &os, unsigned long long seed, const std::vector<result_t> &results)
+{
+    os << "# bench " << results_version << " seed " << seed << '\n';
+    os << "phase\tvertices\tseconds\n";
+    for (const result_t &result : results)
+        for (double t : result.seconds)
+            os << result.phase << '\t' << result.vertices << '\t' << t << '\n';
+}
+
+std::vector<result_t> load_results(std::istream &is, unsigned long long &out_seed)
+{
+    std::string line, magic, seed_key, phase;
+    int version;
+    if (!std::getline(is, line) || !(std::istringstream(line) >> magic >> magic >> version >> seed_key >> out_seed)
+            || magic != "bench" || seed_key != "seed")
+    {
+        std::cerr << "Baseline is not a file saved by bench. Exiting." << std::endl;
+        exit(1);
+    }
+    if (version != results_version)
+    {
+        std::cerr << "Baseline has version " << version << " of the format, expected " << results_version << ". Exiting." << std::endl;
+        exit(1);
+    }
+    std::getline(is, line);
+
+    std::vector<result_t> results;
+    size_t vertices;
+    double t;
+    while (is >> phase >> vertices >> t)
+    {
+        if (results.empty() || results.back().phase != phase || results.back().vertices != vertices)
+            results.push_back({ phase, vertices, {} });
+        results.back().seconds.push_back(t);
+    }
+    for (result_t &result : results)
+        std::sort(result.seconds.begin(), result.seconds.end());
+    return results;
+}
+
+/* The one-sided p-value of the Mann-Whitney U test that the times of b tend to
+ * be larger than those of a, in the normal approximation with a correction
+ * for ties. */
+double mann_whitney(const std::vector<double> &a, const std::vector<double> &b)
+{
+    std::vector<std::pair<double, bool>> all; // (time, is from b)
+    for (double t : a)
+        all.emplace_back(t, false);
+    for (double t : b)
+        all.emplace_back(t, true);
+    std::sort(all.begin(), all.end());
+
+    const double n_a = a.size(), n_b = b.size(), n = all.size();
+    double rank_sum_b = 0, ties = 0;
+    for (size_t i = 0; i < all.size(); )
+    {
+        size_t j = i;
+        while (j < all.size() && all[j].first == all[i].first)
+            ++j;
+        const double rank = (i + 1 + j) / 2.0, k = j - i;
+        for (size_t l = i; l < j; ++l)
+            if (all[l].second)
+                rank_sum_b += rank;
+        ties += k * k * k - k;
+        i = j;
+    }
+    const double u = rank_sum_b - n_b * (n_b + 1) / 2;
+    const double mean = n_a * n_b / 2;
+    const double variance = n_a * n_b / 12 * (n + 1 - ties / (n * (n - 1)));
+    if (variance == 0)
+        return 1;
+    const double z = (u - mean - 0.5) / std::sqrt(variance);
+    return 0.5 * std::erfc(z / std::sqrt(2));
+}
+
+/* the smallest p-value mann_whitney can return for samples of these sizes,
+ * when all times of b are larger than all of a */
+double smallest_p_value(size_t n_a, size_t n_b)
+{
+    std::vector<double> a, b;
+    for (size_t i = 0; i < n_a + n_b; ++i)
+        (i < n_a ? a : b).push_back(i);
+    return mann_whitney(a, b);
+}
+
+/* the slope of the least-squares line through the points (log n, log t) */
+double log_log_slope(const std::vector<std::pair<double, double>> &points)
+{
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (const auto &[n, t] : points)
+    {
+        sx += std::log(n);
+        sy += std::log(t);
+        sxx += std::log(n) * std::log(n);
+        sxy += std::log(n) * std::log(t);
+    }
+    const double k = points.size();
+    return (k * sxy - sx * sy) / (k * sxx - sx * sx);
+}
+
+void usage(char *name)
+{
+    std::cerr << "usage: " << name << " [ --seed s ] [ --warmup w ] [ --repetitions r ] [ --save file ]"
+        << " [ --baseline file [ --alpha a ] [ --threshold f ] ] [ --max-slope k ] [ n ... ]" << std::endl;
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long long seed = 1;
+    size_t warmup = 2, repetitions = 10;
+    double alpha = 0.01, threshold = 0.05, max_slope = 1.25;
+    const char *save_file = nullptr, *baseline_file = nullptr;
+    std::vector<size_t> sizes;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg(argv[i]);
+        if (arg == "--seed" && i + 1 < argc)
+        {
+            if (!(std::istringstream(argv[++i]) >> seed))
+                usage(argv[0]);
+        }
+        else if (arg == "--warmup" && i + 1 < argc)
+        {
+            if (!(std::istringstream(argv[++i]) >> warmup))
+                usage(argv[0]);
+        }
+        else if (arg == "--repetitions" && i + 1 < argc)
+        {
+            if (!(std::istringstream(argv[++i]) >> repetitions) || repetitions == 0)
+                usage(argv[0]);
+        }
+        else if (arg == "--save" && i + 1 < argc)
+            save_file = argv[++i];
+        else if (arg == "--baseline" && i + 1 < argc)
+            baseline_file = argv[++i];
+        else if (arg == "--alpha" && i + 1 < argc)
+        {
+            if (!(std::istringstream(argv[++i]) >> alpha))
+                usage(argv[0]);
+        }
+        else if (arg == "--threshold" && i + 1 < argc)
+        {
+            if (!(std::istringstream(argv[++i]) >> threshold))
+                usage(argv[0]);
+        }
+        else if (arg == "--max-slope" && i + 1 < argc)
+        {
+            if (!(std::istringstream(argv[++i]) >> max_slope))
+                usage(argv[0]);
+        }
+        else
+        {
+            size_t n;
+            if (!(std::istringstream(arg) >> n) || n < 4)
+                usage(argv[0]);
+            sizes.push_back(n);
+        }
+    }
+    if (sizes.empty())
+        sizes = { 1000, 10000, 100000 };
+
+    std::vector<result_t> baseline;
+    if (baseline_file != nullptr)
+    {
+        std::ifstream ifs(baseline_file);
+        if (!ifs)
+        {
+            std::cerr << "Cannot open " << baseline_file << ". Exiting." << std::endl;
+            exit(1);
+        }
+        unsigned long long baseline_seed;
+        baseline = load_results(ifs, baseline_seed);
+        if (baseline_seed != seed)
+            std::cerr << "Warning: baseline was measured on graphs sampled from seed " << baseline_seed << std::endl;
+
+        /* otherwise no regression could ever be reported */
+        size_t baseline_repetitions = repetitions;
+        for (const result_t &base : baseline)
+            baseline_repetitions = std::min(baseline_repetitions, base.seconds.size());
+        const double p = smallest_p_value(baseline_repetitions, repetitions);
+        if (p >= alpha)
+        {
+            std::cerr << "With " << baseline_repetitions << " repetitions in the baseline and " << repetitions
+                << " now, the smallest possible p-value is " << p << ", which is not below alpha = " << alpha
+                << ". Exiting." << std::endl;
+            exit(1);
+        }
+    }
+
+    std::vector<result_t> results;
+    std::cout << "phase\tvertices\trepetitions\tmedian\tp95\tvertices_per_second" << std::endl;
+    for (size_t n : sizes)
+    {
+        /* the same graph for every run with this seed and size */
+        std::mt19937 gen(seed);
+        const graph_t graph = decode_triangulation(find_permutation(random_bitstring(4 * (n - 2) - 2, n - 3, gen)));
+        std::ostringstream os;
+        write_graph(os, graph);
+        const std::string text = os.str();
+
+        double seconds[NUM_PHASES];
+        for (size_t i = 0; i < warmup; ++i)
+            run(text, seconds);
+        const size_t first = results.size();
+        for (unsigned phase = 0; phase < NUM_PHASES; ++phase)
+            results.push_back({ phase_name[phase], graph.num_vertices(), {} });
+        for (size_t i = 0; i < repetitions; ++i)
+        {
+            run(text, seconds);
+            for (unsigned phase = 0; phase < NUM_PHASES; ++phase)
+                results[first + phase].seconds.push_back(seconds[phase]);
+        }
+
+        for (size_t i = first; i < results.size(); ++i)
+        {
+            result_t &result = results[i];
+            std::sort(result.seconds.begin(), result.seconds.end());
+            std::cout << result.phase << '\t' << result.vertices << '\t' << repetitions << '\t' << result.median()
+                << '\t' << result.p95() << '\t' << result.vertices / result.median() << std::endl;
+        }
+    }
+
+    if (save_file != nullptr)
+    {
+        std::ofstream ofs(save_file);
+        save_results(ofs, seed, results);
+    }
+
+    /* Slower than the baseline only counts if it is significant and the
+     * median grew by more than the threshold, so that a shift by timer noise
+     * in many repetitions is not reported. */
+    bool failed = false;
+    for (const result_t &result : results)
+        for (const result_t &base : baseline)
+            if (base.phase == result.phase && base.vertices == result.vertices)
+            {
+                const double p = mann_whitney(base.seconds, result.seconds);
+                const double ratio = result.median() / base.median();
+                if (p < alpha && ratio > 1 + threshold)
+                {
+                    std::cerr << "Regression: " << result.phase << " on " << result.vertices << " vertices takes "
+                        << result.median() << " s instead of " << base.median() << " s (p = " << p << ")" << std::endl;
+                    failed = true;
+                }
+            }
+
+    /* Every phase should take linear time, even though caches make the times
+     * of larger graphs grow a little faster. */
+    if (sizes.size() > 1)
+        for (unsigned phase = 0; phase < NUM_PHASES; ++phase)
+        {
+            std::vector<std::pair<double, double>> points;
+            for (const result_t &result : results)
+                if (result.phase == phase_name[phase] && result.median() > 0)
+                    points.emplace_back(result.vertices, result.median());
+            if (points.size() < 2)
+                continue;
+            const double slope = log_log_slope(points);
+            if (slope > max_slope)
+            {
+                std::cerr << "Superlinear: " << phase_name[phase] << " takes time n^" << slope << std::endl;
+                failed = true;
+            }
+        }
+
+    return failed;
+}
@@ -3,14 +3,11 @@
 #include "include/graph.hpp"
 #include "include/decompose.hpp"
 #include "include/debug_print.hpp"
-
-struct triangle_t {
-    vertex_t u, v, w;
-    size_t e_uv, e_vw, e_wu;
-};
+#include "include/timer.hpp"
 
 std::vector<triangle_t> list_separating_triangles(const graph_t &graph)
 {
+    timer::scope phase("triangles");
     std::vector<triangle_t> out_triangles;
 
     /* sort vertices by degree */
@@ -64,7 +61,7 @@ std::vector<triangle_t> list_separating_triangles(const graph_t &graph)
     return out_triangles;
 }
 
-four_block_tree_t build_four_block_tree(const graph_t &graph)
+status_t build_four_block_tree(const graph_t &graph, four_block_tree_t &out_tree)
 {
     const size_t infinity = graph.num_vertices();
     const vertex_t root = graph.outer_face.front();
@@ -80,6 +77,7 @@ four_block_tree_t build_four_block_tree(const graph_t &graph)
     size_t max_degree = graph.degree(root);
     {
         /* first DFS */
+        timer::scope phase("dfs");
         std::vector<size_t> lowpoint_v = { infinity };
         std::vector<size_t> distance_from_tree_edge_v = { 0 };
         std::vector<unsigned char> return_side_v = { false };
@@ -199,6 +197,7 @@ four_block_tree_t build_four_block_tree(const graph_t &graph)
     std::vector<std::vector<size_t>> edge_order(graph.num_vertices());
     {
         /* find order of edges for each vertex */
+        timer::scope phase("edge_order");
         std::vector<std::vector<size_t>> edges_by_dist_from_tree_edge(max_degree);
         for (size_t e = 0; e < graph.num_edges(); ++e)
             edges_by_dist_from_tree_edge[distance_from_tree_edge[e]].push_back(e);
@@ -225,7 +224,7 @@ four_block_tree_t build_four_block_tree(const graph_t &graph)
                         leftright_edges_by_parent[parent[e]].push_back(e);
                         break;
                     default:
-                        exit(1);
+                        return fail(status_t::NOT_DRAWABLE, "Cannot decompose the graph into 4-connected components");
                 }
 
         for (vertex_t v = 0; v < graph.num_vertices(); ++v)
@@ -271,6 +270,7 @@ four_block_tree_t build_four_block_tree(const graph_t &graph)
     std::vector<size_t> triangle_order;
     {
         /* find order of separating triangles */
+        timer::scope phase("triangle_order");
         std::vector<std::vector<size_t>> triangles_by_edge(graph.num_edges());
         for (size_t t = 0; t < separating_triangles.size(); ++t)
         {
@@ -360,6 +360,7 @@ four_block_tree_t build_four_block_tree(const graph_t &graph)
     const size_t virtual_edge = original_edge.size();
     {
         /* split graph along separating triangles */
+        timer::scope phase("split");
         mut_edges.reserve(original_edge.size());
         for (const auto &e : graph.edges)
             mut_edges.push_back({ e.tail, e.head, {}, {} });
@@ -535,9 +536,11 @@ four_block_tree_t build_four_block_tree(const graph_t &graph)
     }
 #endif // DEBUG
 
-    four_block_tree_t result;
+    four_block_tree_t &result = out_tree;
+    result.clear();
     {
         /* find 4-connected components */
+        timer::scope phase("extract");
         triangle_order.push_back(separating_triangles.size());
         separating_triangles.push_back({ graph.outer_face[0], graph.outer_face[1], graph.outer_face[2], {}, {}, {} });
 
@@ -545,6 +548,8 @@ four_block_tree_t build_four_block_tree(const graph_t &graph)
         std::vector<bool> traversed(mut_edges.size(), false);
         std::vector<size_t> mapped_vertex(adjacency_list.size());
         std::vector<size_t> mapped_edge(mut_edges.size());
+        std::vector<size_t> component_of_edge(mut_edges.size());
+        std::vector<size_t> depth;
         for (auto it = triangle_order.crbegin(); it != triangle_order.crend(); ++it)
         {
             size_t i = *it;
@@ -561,6 +566,7 @@ four_block_tree_t build_four_block_tree(const graph_t &graph)
                     {
                         DEBUG_PRINT("found edge " << e);
                         traversed[e] = true;
+                        component_of_edge[e] = result.size() - 1;
                         mapped_edge[e] = result.back().original_edge.size();
                         result.back().original_edge.push_back(e);
                         const vertex_t w = v == mut_edges[e].tail ? mut_edges[e].head : mut_edges[e].tail;
@@ -575,6 +581,23 @@ four_block_tree_t build_four_block_tree(const graph_t &graph)
             }
 
             result.back().outer_face = { mapped_vertex[separating_triangles[i].u], mapped_vertex[separating_triangles[i].v], mapped_vertex[separating_triangles[i].w] };
+
+            /* The edges of the triangle on its outside kept their ids when it
+             * was split.  Each lies in the surrounding component or, if an
+             * enclosing triangle shares it, in an ancestor of that, but at
+             * least one lies in the surrounding component, which is the
+             * deepest of them. */
+            depth.push_back(0);
+            if (result.size() > 1)
+            {
+                const triangle_t &t = separating_triangles[i];
+                for (size_t e : { t.e_uv, t.e_vw, t.e_wu })
+                    if (depth[component_of_edge[e]] + 1 > depth.back())
+                    {
+                        depth.back() = depth[component_of_edge[e]] + 1;
+                        result.back().parent = component_of_edge[e];
+                    }
+            }
             result.back().edges.reserve(result.back().original_edge.size());
             result.back().vertices.reserve(bfs_queue.size());
             result.back().designated_face.resize(bfs_queue.size(), 0);
@@ -627,5 +650,5 @@ four_block_tree_t build_four_block_tree(const graph_t &graph)
         }
     }
 
-    return result;
+    return status_t::OK;
 }
@@ -0,0 +1,114 @@
+#include <sstream>
+#include "include/draw.hpp"
+#include "include/port_assignment.hpp"
+#include "include/rectangular_dual.hpp"
+#include "include/decompose.hpp"
+#include "include/io.hpp"
+#include "include/timer.hpp"
+#include "include/verify.hpp"
+
+status_t drawing_context_t::read(std::istream &is)
+{
+    return read_graph(is, graph);
+}
+
+status_t drawing_context_t::draw(const graph_t &g, const draw_options_t &options, std::ostream *duals_os)
+{
+    if (g.outer_face.size() != 3)
+        return fail(status_t::NOT_DRAWABLE, "Outer face must be a triangle");
+    status_t status;
+    {
+        timer::scope phase("decompose", timer::DECOMPOSE);
+        status = build_four_block_tree(g, four_block_tree);
+    }
+    if (status != status_t::OK)
+        return status;
+    if (options.stats)
+        stats = tree_stats(four_block_tree);
+
+    status = construct_drawing(g, four_block_tree, drawing, counts, buffers,
+            options.print_duals ? duals_os : nullptr, options.num_threads, options.level_order);
+    if (status != status_t::OK)
+        return status;
+    if (options.compact)
+    {
+        timer::scope phase("compact", timer::COMPACT);
+        compact_drawing(g, drawing);
+    }
+
+    if (options.verify)
+    {
+        timer::scope phase("verify", timer::VERIFY);
+        const report_t report = check_crossings(g, drawing, check_mode_t::FIRST, options.num_threads);
+        if (report.num_crossings != 0)
+        {
+            std::ostringstream message;
+            message << "Drawing is not planar, " << report.first;
+            return fail(status_t::INVALID_DRAWING, message.str());
+        }
+        if (check_extents(g, drawing) != status_t::OK)
+            return fail(status_t::INVALID_DRAWING, "Drawing is not planar, " + error_message());
+    }
+    return status_t::OK;
+}
+
+status_t drawing_context_t::draw_rect_dual(const graph_t &g, const draw_options_t &options)
+{
+    if (g.outer_face.size() != 4)
+        return fail(status_t::NOT_DRAWABLE, "Outer face must be a 4-cycle");
+    status_t status;
+    {
+        timer::scope phase("rect_dual", timer::RECT_DUAL);
+        status = compute_rect_dual(g, dual);
+    }
+    if (status != status_t::OK)
+        return status;
+
+    if (options.verify)
+    {
+        timer::scope phase("verify", timer::VERIFY);
+        if (check_rect_dual(g, dual) != status_t::OK)
+            return fail(status_t::INVALID_DRAWING, "Rectangular dual is invalid, " + error_message());
+    }
+    return status_t::OK;
+}
+
+status_t draw(drawing_context_t &context, const graph_t &graph, std::ostream &os, const draw_options_t &options)
+{
+    if (options.rect_dual)
+    {
+        const status_t status = context.draw_rect_dual(graph, options);
+        if (status != status_t::OK)
+            return status;
+
+        timer::scope phase("write", timer::IO);
+        if (options.tikz)
+        {
+            write_latex_header(os);
+            write_tikz(os, graph, context.dual);
+            write_latex_footer(os);
+        }
+        else
+            write_raw(os, context.dual);
+    }
+    else
+    {
+        /* the duals printed by construct_drawing go into the document */
+        if (options.tikz)
+            write_latex_header(os);
+
+        const status_t status = context.draw(graph, options, &os);
+        if (status != status_t::OK)
+            return status;
+
+        timer::scope phase("write", timer::IO);
+        if (options.tikz)
+        {
+            write_tikz(os, graph, context.drawing);
+            write_latex_footer(os);
+        }
+        else
+            write_raw(os, context.drawing);
+    }
+    return status_t::OK;
+}
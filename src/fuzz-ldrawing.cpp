@@ -0,0 +1,159 @@
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "include/sampling.hpp"
+#include "include/decompose.hpp"
+#include "include/port_assignment.hpp"
+#include "include/verify.hpp"
+
+/* The sample a thread is working on.  If the drawing code exits or crashes,
+ * this is written out from the atexit or signal handler, which runs on the
+ * failing thread.  Everything the handler needs is prepared before the sample
+ * is marked valid, so that it only has to open, write and close the file. */
+struct in_flight_t {
+    char path[4096];
+    /* the bitstring followed by a newline */
+    std::string bitstring;
+    const char *data;
+    size_t size;
+    std::atomic<bool> valid{ false };
+};
+thread_local in_flight_t *in_flight = nullptr;
+std::string out_dir = ".";
+
+/* only calls open(2), write(2) and close(2), which are async-signal-safe, so
+ * it can be called from a signal handler */
+void save_in_flight(void)
+{
+    if (in_flight == nullptr || !in_flight->valid)
+        return;
+    in_flight->valid = false;
+    const int fd = open(in_flight->path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return;
+    for (size_t written = 0; written < in_flight->size; )
+    {
+        const ssize_t count = write(fd, in_flight->data + written, in_flight->size - written);
+        if (count <= 0)
+            break;
+        written += count;
+    }
+    close(fd);
+}
+
+void on_signal(int sig)
+{
+    save_in_flight();
+    std::signal(sig, SIG_DFL);
+    std::raise(sig);
+}
+
+void usage(char *name)
+{
+    std::cerr << "usage: " << name
+        << " [ --threads t ] [ --seed s ] [ --count k ] [ --out-dir dir ] n" << std::endl;
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    unsigned long long first_seed = std::random_device()();
+    size_t count = 1000, n = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg(argv[i]);
+        if (arg == "--threads" && i + 1 < argc)
+        {
+            if (!(std::istringstream(argv[++i]) >> num_threads) || num_threads == 0)
+                usage(argv[0]);
+        }
+        else if (arg == "--seed" && i + 1 < argc)
+        {
+            if (!(std::istringstream(argv[++i]) >> first_seed))
+                usage(argv[0]);
+        }
+        else if (arg == "--count" && i + 1 < argc)
+        {
+            if (!(std::istringstream(argv[++i]) >> count))
+                usage(argv[0]);
+        }
+        else if (arg == "--out-dir" && i + 1 < argc)
+            out_dir = argv[++i];
+        else if (i + 1 == argc)
+        {
+            if (!(std::istringstream(arg) >> n))
+                usage(argv[0]);
+        }
+        else
+            usage(argv[0]);
+    }
+    if (n < 2)
+        usage(argv[0]);
+
+    std::atexit(save_in_flight);
+    std::signal(SIGSEGV, on_signal);
+    std::signal(SIGABRT, on_signal);
+    std::signal(SIGFPE,  on_signal);
+
+    std::atomic<size_t> next_sample(0), num_failures(0);
+    auto fuzz = [&]()
+    {
+        in_flight_t slot;
+        in_flight = &slot;
+        std::mt19937 gen;
+        four_block_tree_t four_block_tree;
+        l_drawing_t drawing;
+        drawing_counts_t counts;
+        drawing_buffers_t buffers;
+        for (size_t i; (i = next_sample++) < count; )
+        {
+            const unsigned long long seed = first_seed + i;
+            gen.seed(seed);
+            auto bitstring = find_permutation(random_bitstring(4 * n - 2, n - 1, gen));
+            slot.bitstring.assign(bitstring.size(), '0');
+            for (size_t j = 0; j < bitstring.size(); ++j)
+                if (bitstring[j])
+                    slot.bitstring[j] = '1';
+            slot.bitstring += '\n';
+            std::snprintf(slot.path, sizeof slot.path, "%s/bitstring%llu", out_dir.c_str(), seed);
+            slot.data = slot.bitstring.data();
+            slot.size = slot.bitstring.size();
+            slot.valid = true;
+
+            const graph_t graph = decode_triangulation(bitstring);
+
+            if (build_four_block_tree(graph, four_block_tree) != status_t::OK
+                    || construct_drawing(graph, four_block_tree, drawing, counts, buffers) != status_t::OK
+                    || check_crossings(graph, drawing).num_crossings != 0)
+            {
+                ++num_failures;
+                std::ofstream(slot.path) << slot.bitstring << std::flush;
+            }
+            slot.valid = false;
+        }
+        in_flight = nullptr;
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned t = 1; t < num_threads; ++t)
+        threads.emplace_back(fuzz);
+    fuzz();
+    for (std::thread &thread : threads)
+        thread.join();
+
+    std::cerr << count << " graphs with seeds " << first_seed << " to " << first_seed + count - 1
+        << ", " << num_failures << " failed" << std::endl;
+    return num_failures != 0;
+}
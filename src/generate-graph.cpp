@@ -0,0 +1,52 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "include/generators.hpp"
+#include "include/io.hpp"
+
+void usage(char *name)
+{
+    std::cerr << "usage: " << name << " [ --binary ] ( nested | hub | irreducible | strip ) size" << std::endl;
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    bool binary = false;
+    std::string family;
+    size_t size = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg(argv[i]);
+        if (arg == "--binary")
+            binary = true;
+        else if (i + 2 == argc)
+            family = arg;
+        else if (i + 1 == argc)
+        {
+            if (!(std::istringstream(arg) >> size))
+                usage(argv[0]);
+        }
+        else
+            usage(argv[0]);
+    }
+
+    graph_t graph;
+    if (family == "nested" && size >= 2)
+        graph = nested_triangles(size);
+    else if (family == "hub" && size >= 4)
+        graph = double_wheel(size);
+    else if (family == "irreducible" && size >= 2)
+        graph = irreducible_grid(size);
+    else if (family == "strip" && size >= 2)
+        graph = triangulated_strip(size);
+    else
+        usage(argv[0]);
+
+    if (binary)
+        write_binary_graph(std::cout, graph);
+    else
+        write_graph(std::cout, graph);
+
+    return 0;
+}
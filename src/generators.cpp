@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <array>
+#include <vector>
+#include "include/generators.hpp"
+#include "include/sampling.hpp"
+
+typedef std::array<size_t, 3> triangle_t;
+
+/* Builds the rotation systems of a plane graph with n vertices from its inner
+ * faces, which are triangles given in counter-clockwise order, and its outer
+ * face, also in counter-clockwise order.  An edge joins its lower to its
+ * higher end, and the edge between vertices n-2 and n-1, if any, is the last
+ * one and the first in the rotations of both, as make_bimodal expects. */
+sample_graph_t from_faces(size_t n, const std::vector<triangle_t> &triangles, const std::vector<size_t> &outer_face)
+{
+    /* around v, the neighbor after the one given in counter-clockwise order,
+     * and the edge to that neighbor */
+    struct corner_t {
+        size_t neighbor, next, edge;
+        bool operator<(const corner_t &other) const { return neighbor < other.neighbor; }
+    };
+    std::vector<std::vector<corner_t>> corners(n);
+    /* face cycles are walked with the face on the left, which means inner
+     * faces forward and the outer face backward */
+    for (const triangle_t &t : triangles)
+        for (size_t i = 0; i < 3; ++i)
+            corners[t[i]].push_back({ t[(i + 1) % 3], t[(i + 2) % 3], 0 });
+    const size_t o = outer_face.size();
+    for (size_t i = 0; i < o; ++i)
+        corners[outer_face[i]].push_back({ outer_face[(i + o - 1) % o], outer_face[(i + 1) % o], 0 });
+    for (auto &around_v : corners)
+        std::sort(around_v.begin(), around_v.end());
+    auto corner = [&](size_t v, size_t w) -> corner_t &
+    {
+        return *std::lower_bound(corners[v].begin(), corners[v].end(), corner_t{ w, 0, 0 });
+    };
+
+    sample_graph_t graph;
+    for (size_t v = 0; v < n; ++v)
+        graph.add_vertex();
+    bool has_last_edge = false;
+    for (size_t v = 0; v < n; ++v)
+        for (corner_t &c : corners[v])
+        {
+            if (c.neighbor < v)
+                continue;
+            if (v == n - 2 && c.neighbor == n - 1)
+            {
+                has_last_edge = true;
+                continue;
+            }
+            c.edge = corner(c.neighbor, v).edge = graph.add_edge(v, c.neighbor);
+        }
+    if (has_last_edge)
+        corner(n - 2, n - 1).edge = corner(n - 1, n - 2).edge = graph.add_edge(n - 2, n - 1);
+
+    for (size_t v = 0; v < n; ++v)
+    {
+        if (corners[v].empty())
+            continue;
+        size_t w = corners[v].front().neighbor;
+        if (has_last_edge && v >= n - 2)
+            w = v == n - 2 ? n - 1 : n - 2;
+        for (size_t i = 0; i < corners[v].size(); ++i)
+        {
+            const corner_t &c = corner(v, w);
+            const auto &e = graph.edges[c.edge];
+            graph.push_back(v, e.tail == v ? e.tail_it : e.head_it);
+            w = c.next;
+        }
+    }
+    return graph;
+}
+
+/* a bimodal orientation of a triangulation whose outer face is n-3, n-2, n-1 */
+graph_t orient(sample_graph_t &&graph)
+{
+    make_bimodal(graph);
+    return to_graph(graph, graph.num_vertices() - 3);
+}
+
+graph_t nested_triangles(size_t k)
+{
+    /* triangle j consists of 3j, 3j+1 and 3j+2, the innermost one is 0 */
+    std::vector<triangle_t> triangles = { { 0, 1, 2 } };
+    for (size_t j = 0; j + 1 < k; ++j)
+        for (size_t i = 0; i < 3; ++i)
+        {
+            const size_t a = 3 * (j + 1) + i, a_next = 3 * (j + 1) + (i + 1) % 3;
+            const size_t b = 3 * j + i, b_next = 3 * j + (i + 1) % 3;
+            triangles.push_back({ a, a_next, b });
+            triangles.push_back({ b, a_next, b_next });
+        }
+    return orient(from_faces(3 * k, triangles, { 3 * k - 3, 3 * k - 2, 3 * k - 1 }));
+}
+
+graph_t double_wheel(size_t m)
+{
+    /* 0 is inside, 1 to m is the cycle, and m+1 is outside */
+    auto cycle = [&](size_t i) { return 1 + i % m; };
+    std::vector<triangle_t> triangles;
+    for (size_t i = 0; i < m; ++i)
+    {
+        triangles.push_back({ 0, cycle(i), cycle(i + 1) });
+        if (i != m - 2)
+            triangles.push_back({ m + 1, cycle(i + 1), cycle(i) });
+    }
+    return orient(from_faces(m + 2, triangles, { m - 1, m, m + 1 }));
+}
+
+/* vertex (i,j) of the grid is i*cols+j, where row 0 is the top one; then
+ * follow the vertices to the right, above, to the left and below */
+std::vector<triangle_t> grid_faces(size_t rows, size_t cols)
+{
+    const size_t right = rows * cols, above = right + 1, left = right + 2, below = right + 3;
+    auto at = [&](size_t i, size_t j) { return i * cols + j; };
+    std::vector<triangle_t> triangles;
+    for (size_t i = 0; i + 1 < rows; ++i)
+        for (size_t j = 0; j + 1 < cols; ++j)
+        {
+            triangles.push_back({ at(i, j), at(i + 1, j), at(i + 1, j + 1) });
+            triangles.push_back({ at(i, j), at(i + 1, j + 1), at(i, j + 1) });
+        }
+    for (size_t j = 0; j + 1 < cols; ++j)
+    {
+        triangles.push_back({ at(0, j), at(0, j + 1), above });
+        triangles.push_back({ at(rows - 1, j + 1), at(rows - 1, j), below });
+    }
+    for (size_t i = 0; i + 1 < rows; ++i)
+    {
+        triangles.push_back({ at(i + 1, 0), at(i, 0), left });
+        triangles.push_back({ at(i, cols - 1), at(i + 1, cols - 1), right });
+    }
+    triangles.push_back({ at(0, 0), above, left });
+    triangles.push_back({ at(0, cols - 1), right, above });
+    triangles.push_back({ at(rows - 1, cols - 1), below, right });
+    triangles.push_back({ at(rows - 1, 0), left, below });
+    return triangles;
+}
+
+graph_t irreducible_grid(size_t k)
+{
+    const size_t right = k * k, above = right + 1, left = right + 2, below = right + 3;
+    const std::vector<size_t> outer_face = { above, left, below, right };
+    graph_t graph = to_graph(from_faces(k * k + 4, grid_faces(k, k), outer_face), 0);
+    graph.outer_face = outer_face;
+    return graph;
+}
+
+graph_t triangulated_strip(size_t l)
+{
+    const size_t right = 3 * l, above = right + 1, left = right + 2, below = right + 3;
+    std::vector<triangle_t> triangles = grid_faces(3, l);
+    triangles.push_back({ above, right, below });
+    return orient(from_faces(3 * l + 4, triangles, { above, left, below }));
+}
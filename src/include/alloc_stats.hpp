@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+
+/* Allocations through operator new of the whole program so far.  They are
+ * only counted if the program is built with alloc_stats=yes, which defines
+ * ALLOC_STATS, otherwise they are all 0. */
+struct alloc_stats_t {
+    size_t allocations, bytes;
+    size_t live_bytes, peak_live_bytes;
+};
+
+alloc_stats_t alloc_stats(void);
+
+/* Starts a new peak of the bytes in use, from those in use now, and returns
+ * the peak so far.  Pass that to end_peak_live_bytes, which returns the peak
+ * since and continues the one before, so that peaks can be nested. */
+size_t begin_peak_live_bytes(void);
+size_t end_peak_live_bytes(size_t outer_peak);
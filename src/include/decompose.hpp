@@ -1,4 +1,15 @@
 #pragma once
+
+#include <vector>
 #include "graph.hpp"
+#include "status.hpp"
+
+struct triangle_t {
+    vertex_t u, v, w;
+    size_t e_uv, e_vw, e_wu;
+};
+
+/* the triangles of the graph that are not faces */
+std::vector<triangle_t> list_separating_triangles(const graph_t &);
 
-four_block_tree_t build_four_block_tree(const graph_t &);
+status_t build_four_block_tree(const graph_t &, four_block_tree_t &out_tree);
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <iostream>
+#include "graph.hpp"
+#include "port_assignment.hpp"
+#include "stats.hpp"
+#include "status.hpp"
+
+/* what ldrawing does with a graph, set by its flags of the same names */
+struct draw_options_t {
+    bool rect_dual, print_duals, tikz, level_order, compact, verify, stats;
+    unsigned num_threads;
+};
+
+/* The drawing as a library.  A context keeps the results of the last call and
+ * everything needed on the way, so that drawing many graphs with one context
+ * mostly reuses their memory; a context must not be used by two threads at
+ * once.  All functions return status_t::OK or an error, described by
+ * error_message(), and never exit. */
+struct drawing_context_t {
+    graph_t graph; // filled by read
+    four_block_tree_t four_block_tree;
+    l_drawing_t drawing; // filled by draw
+    rectangular_dual_t dual; // filled by draw_rect_dual
+    tree_stats_t stats{}; // filled by draw if options.stats is set
+    drawing_counts_t counts{}; // filled by draw
+    drawing_buffers_t buffers; // used by draw
+
+    /* reads a graph in either format of graph-format.md into graph */
+    status_t read(std::istream &);
+    /* a planar L-drawing of the graph, which must be a bimodal triangulation;
+     * only options.compact, level_order, num_threads, verify and stats are
+     * used, and options.print_duals writes the duals of the components to
+     * duals_os */
+    status_t draw(const graph_t &, const draw_options_t &, std::ostream *duals_os = nullptr);
+    /* a rectangular dual of the graph, which must be an irreducible
+     * triangulation of its outer 4-cycle; only options.verify is used */
+    status_t draw_rect_dual(const graph_t &, const draw_options_t &);
+};
+
+/* Draws the graph with the context and writes the drawing to os, as
+ * ldrawing does with these options, except for the statistics, which are left
+ * in the context. */
+status_t draw(drawing_context_t &, const graph_t &, std::ostream &os, const draw_options_t &);
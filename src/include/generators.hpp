@@ -0,0 +1,28 @@
+#pragma once
+
+#include "graph.hpp"
+
+/* Graphs of particular shapes, to measure how single phases of the drawing
+ * scale in their worst cases.  Except for irreducible_grid, all of them are
+ * plane triangulations with a bimodal orientation that ldrawing can draw. */
+
+/* k triangles nested in each other, consecutive ones joined like an
+ * octahedron, so there are k-2 separating triangles in a chain (all but the
+ * outer face and the innermost triangle) and k-1 4-connected components; 3k
+ * vertices */
+graph_t nested_triangles(size_t k);
+
+/* a cycle of length m with one vertex inside and one outside adjacent to all
+ * of it, which is 4-connected for m >= 4; m+2 vertices */
+graph_t double_wheel(size_t m);
+
+/* a k×k grid, where every cell is split by a diagonal, surrounded by four
+ * vertices adjacent to the sides of the grid, which is an irreducible
+ * triangulation of the outer 4-cycle as needed for --rect-dual; the edges are
+ * oriented by index; k²+4 vertices */
+graph_t irreducible_grid(size_t k);
+
+/* the same as irreducible_grid for a 3×l grid, with an edge between the
+ * vertices above and below the grid to make the outer face a triangle, so it
+ * is a long 4-connected triangulation; 3l+4 vertices */
+graph_t triangulated_strip(size_t l);
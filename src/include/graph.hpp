@@ -88,5 +88,7 @@ typedef std::vector<position_t> l_drawing_t;
 struct four_connected_component_t : public graph_t {
     std::vector<size_t> original_edge{};
     std::vector<size_t> designated_face{};
+    /* index of the component surrounding this one, the root is its own parent */
+    size_t parent{};
 };
 typedef std::vector<four_connected_component_t> four_block_tree_t;
@@ -1,10 +1,85 @@
 #pragma once
 
+#include <charconv>
+#include <cstdint>
 #include <iostream>
 #include <sstream>
 #include "graph.hpp"
+#include "status.hpp"
 
-graph_t read_graph(std::istream &);
+/* Collects output and hands it to the stream in large blocks, instead of
+ * formatting and possibly flushing every value on its own. */
+class buffered_writer {
+    std::ostream &os;
+    char buffer[1 << 16];
+    size_t used = 0;
+
+    void reserve(size_t n)
+    {
+        if (used + n > sizeof buffer)
+            flush();
+    }
+
+public:
+    explicit buffered_writer(std::ostream &_os) : os(_os) {}
+    buffered_writer(const buffered_writer &) = delete;
+    ~buffered_writer() { flush(); }
+
+    void flush()
+    {
+        os.write(buffer, used);
+        os.flush();
+        used = 0;
+    }
+
+    void put(char c)
+    {
+        reserve(1);
+        buffer[used++] = c;
+    }
+
+    void put(const std::string &str)
+    {
+        if (str.size() > sizeof buffer)
+        {
+            flush();
+            os.write(str.data(), str.size());
+            return;
+        }
+        reserve(str.size());
+        str.copy(buffer + used, str.size());
+        used += str.size();
+    }
+
+    /* in decimal */
+    void put_uint(unsigned long long value)
+    {
+        reserve(20);
+        used = std::to_chars(buffer + used, buffer + sizeof buffer, value).ptr - buffer;
+    }
+
+    /* in binary, little-endian */
+    void put_u32(uint32_t value)
+    {
+        reserve(4);
+        for (int i = 0; i < 4; ++i)
+            buffer[used++] = char(value >> 8 * i & 0xff);
+    }
+};
+
+/* reads either format described in graph-format.md into a graph whose
+ * vectors are reused */
+status_t read_graph(std::istream &, graph_t &out_graph);
+
+/* in the text format of graph-format.md */
+void write_graph(std::ostream &, const graph_t &);
+
+void write_binary_graph(std::ostream &, const graph_t &);
+
+/* a code as written by sample-triangulation, either as text or packed */
+status_t read_code(std::istream &, std::vector<bool> &out_bitstring);
+
+void write_packed_code(std::ostream &, const std::vector<bool> &);
 
 void write_raw(std::ostream &, const l_drawing_t &);
 
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+const size_t max_perf_counters = 8;
+
+/* Opens counters for cycles, instructions, cache misses, branch misses and
+ * page faults with perf_event_open.  If the hardware events are not available,
+ * as in many virtual machines, they are replaced by software events.  Each
+ * thread counts only its own events, in a group of counters it opens the
+ * first time it reads them.  Returns the number of counters opened. */
+size_t open_perf_counters(void);
+
+/* the names of the counters opened, in order */
+const std::vector<std::string> &perf_counter_names(void);
+
+/* writes the current value of each counter of the calling thread to out, all
+ * read at once, or zeros if the thread could not open them */
+void read_perf_counters(uint64_t *out);
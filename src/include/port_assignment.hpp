@@ -1,5 +1,61 @@
 #pragma once
 
+#include <iostream>
+#include <vector>
 #include "graph.hpp"
+#include "stats.hpp"
+#include "status.hpp"
 
-l_drawing_t construct_drawing(const graph_t &, four_block_tree_t &, bool);
+/* H_SHAPE: TTT
+ *          X W
+ *          SSS
+ * cases a, d, h, y use this
+ *
+ * LONG_SINK: TXW
+ *            T W
+ *            TSS
+ * case b uses this
+ *
+ * T_SHAPE: TXW
+ *          T W
+ *          SSS
+ * cases e, g, x use this
+ *
+ * LONG_SOURCE: WXS
+ *              W S
+ *              TTS
+ * case f uses this
+ */
+enum class outer_face_t : char { H_SHAPE, LONG_SINK, T_SHAPE, LONG_SOURCE };
+
+/* The memory construct_drawing needs besides its result.  It is only ever
+ * resized, so drawing one graph after another with the same buffers allocates
+ * little once they have grown to the largest graph. */
+struct drawing_buffers_t {
+    std::vector<port_assignment_t> pa;
+    rectangular_dual_t rect_dual; // of the current component
+    std::vector<coord_t> x_coords, y_coords;
+    /* the two dags of toposort_dags as adjacency arrays, [0] for x and [1]
+     * for y */
+    std::vector<size_t> indeg[2], first_out[2], next_out[2];
+    std::vector<vertex_t> out_neighbor[2];
+};
+
+/* Counts what it did in out_counts, and writes the rectangular dual of every
+ * component to duals_os unless that is null. */
+status_t construct_drawing(const graph_t &, four_block_tree_t &, l_drawing_t &out_drawing, drawing_counts_t &out_counts,
+        drawing_buffers_t &, std::ostream *duals_os = nullptr, unsigned num_threads = 1, bool level_order = false);
+void compact_drawing(const graph_t &, l_drawing_t &);
+
+/* The steps of construct_drawing, so they can be benchmarked in isolation.
+ * For each component of the 4-block tree, parents first: add_x, then
+ * compute_rect_dual, fix_rectangular_dual, add_virtual_edges and
+ * port_assignment; port_assignment_of_outer_face once before for the root, and
+ * toposort_dags once after. */
+void port_assignment_of_outer_face(const four_connected_component_t &, port_assignment_t *);
+status_t add_x(four_connected_component_t &, const port_assignment_t *, size_t dummy_edge, outer_face_t &out_drawing_of_outer_face);
+void fix_rectangular_dual(const graph_t &, rectangular_dual_t &, outer_face_t);
+void add_virtual_edges(four_connected_component_t &, rectangular_dual_t &, size_t dummy_edge);
+void port_assignment(const four_connected_component_t &, const rectangular_dual_t &, port_assignment_t *, unsigned num_threads, drawing_counts_t &out_counts);
+status_t toposort_dags(const graph_t &, const port_assignment_t *, coord_t *out_x, coord_t *out_y, unsigned num_threads, bool level_order,
+        drawing_buffers_t &);
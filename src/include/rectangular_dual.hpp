@@ -1,5 +1,6 @@
 #pragma once
 
 #include "graph.hpp"
+#include "status.hpp"
 
-rectangular_dual_t compute_rect_dual(const graph_t &);
+status_t compute_rect_dual(const graph_t &, rectangular_dual_t &out_dual);
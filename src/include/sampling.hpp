@@ -0,0 +1,103 @@
+#pragma once
+
+#include <iostream>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "graph.hpp"
+
+/* The sampler's own representation.  The rotation system of each vertex is a
+ * cyclic doubly linked list, and the nodes of all these lists are kept in one
+ * pool: nodes 2e and 2e+1 belong to edge e, one for each end.  Thus edges can
+ * be inserted into rotations in constant time without allocating a node each.
+ * Node indices are 32 bits wide, which limits the sampler to graphs with fewer
+ * than 2^31 edge ends. */
+struct sample_graph_t {
+    typedef uint32_t node_t;
+    static constexpr node_t none = UINT32_MAX;
+    struct edge_t {
+        size_t tail, head;
+        node_t tail_it, head_it;
+    };
+    std::vector<edge_t> edges;
+    std::vector<node_t> first; // per vertex, the node where its rotation starts
+    std::vector<node_t> next, prev; // per node
+
+    size_t num_vertices() const { return first.size(); }
+
+    size_t add_vertex()
+    {
+        first.push_back(none);
+        return first.size() - 1;
+    }
+
+    /* adds an edge whose ends are not in any rotation yet */
+    size_t add_edge(size_t tail, size_t head)
+    {
+        const size_t e = edges.size();
+        edges.push_back({ tail, head, node_t(2 * e), node_t(2 * e + 1) });
+        next.resize(2 * e + 2, none);
+        prev.resize(2 * e + 2, none);
+        return e;
+    }
+
+    static size_t edge_of(node_t node) { return node / 2; }
+
+    /* inserts node after pos, which stays in front of it */
+    void insert_after(node_t pos, node_t node)
+    {
+        next[node] = next[pos];
+        prev[node] = pos;
+        prev[next[pos]] = node;
+        next[pos] = node;
+    }
+
+    /* inserts node as the last one of the rotation of v */
+    void push_back(size_t v, node_t node)
+    {
+        if (first[v] == none)
+            first[v] = next[node] = prev[node] = node;
+        else
+            insert_after(prev[first[v]], node);
+    }
+
+    void push_front(size_t v, node_t node)
+    {
+        push_back(v, node);
+        first[v] = node;
+    }
+
+    /* inserts node before pos, which is in the rotation of v */
+    void insert_before(size_t v, node_t pos, node_t node)
+    {
+        insert_after(prev[pos], node);
+        if (first[v] == pos)
+            first[v] = node;
+    }
+};
+
+std::vector<bool> random_bitstring(size_t length, size_t weight, std::mt19937 &);
+
+std::vector<bool> find_permutation(const std::vector<bool> &);
+
+sample_graph_t code_to_tree(const std::vector<bool> &);
+
+size_t complete_closure(sample_graph_t &);
+
+void make_bimodal(sample_graph_t &);
+
+void insert_2_cycles(sample_graph_t &, std::mt19937 &);
+
+void print_graph(std::ostream &, const sample_graph_t &, size_t v0);
+
+void print_binary_graph(std::ostream &, const sample_graph_t &, size_t v0);
+
+graph_t to_graph(const sample_graph_t &, size_t v0);
+
+/* n if the bitstring is the code of a triangulation with n+2 vertices, i.e. it
+ * has length 4n-2 and contains n-1 ones, otherwise 0 */
+size_t code_size(const std::vector<bool> &);
+
+/* the bimodal triangulation that sample-triangulation builds from this code,
+ * without 2-cycles */
+graph_t decode_triangulation(const std::vector<bool> &);
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <iostream>
+#include <vector>
+#include "graph.hpp"
+
+/* What one call of construct_drawing did, summed over all components.  Each
+ * event costs an increment, so they are always counted. */
+struct drawing_counts_t {
+    /* components by the drawing of their outer face, in the order of
+     * outer_face_t: H-shape, long sink, T-shape, long source */
+    size_t outer_face[4];
+    /* vertices that are the master of two neighbors in the extra rule */
+    size_t extra_rules;
+    /* vertices whose ports were assigned only after their master's */
+    size_t postponed_vertices;
+    /* vertices added by add_virtual_edges */
+    size_t virtual_vertices;
+
+    drawing_counts_t &operator+=(const drawing_counts_t &other)
+    {
+        for (unsigned of = 0; of < 4; ++of)
+            outer_face[of] += other.outer_face[of];
+        extra_rules += other.extra_rules;
+        postponed_vertices += other.postponed_vertices;
+        virtual_vertices += other.virtual_vertices;
+        return *this;
+    }
+};
+
+/* Has to be taken before construct_drawing adds vertices to the components. */
+struct tree_stats_t {
+    size_t components, depth;
+    /* size_histogram[i] is the number of components with 2^i to 2^(i+1)-1 vertices */
+    std::vector<size_t> size_histogram;
+};
+tree_stats_t tree_stats(const four_block_tree_t &);
+
+/* everything above and the extents of the drawing as a JSON object */
+void write_stats(std::ostream &, const tree_stats_t &, const drawing_counts_t &, const l_drawing_t &);
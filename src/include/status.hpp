@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+
+/* What the functions of the drawing return instead of exiting.  The
+ * message of the last error on each thread says what went wrong. */
+enum class status_t : unsigned char {
+    OK,
+    /* the input could not be read as a graph */
+    INVALID_INPUT,
+    /* the graph is not of the kind that can be drawn, e.g. not a bimodal
+     * triangulation, or not irreducible for a rectangular dual */
+    NOT_DRAWABLE,
+    /* verification found a crossing or an invalid rectangular dual */
+    INVALID_DRAWING
+};
+
+/* sets the message of the last error on this thread and returns status */
+status_t fail(status_t status, const std::string &message);
+
+const std::string &error_message(void);
@@ -2,14 +2,50 @@
 
 #include <chrono>
 #include <iostream>
+#include <string>
+#include "perf_counters.hpp"
 
 class timer {
-    static std::chrono::time_point<std::chrono::steady_clock> start_point[];
-    static double duration[];
+    /* per thread, so that drawings can be computed concurrently */
+    static thread_local std::chrono::time_point<std::chrono::steady_clock> start_point[];
 public:
-    enum activity_t : unsigned char { IO = 0, DECOMPOSE = 1, RECT_DUAL = 2, PORT_ASSIGNMENT = 3 };
+    enum activity_t : unsigned char { IO = 0, DECOMPOSE = 1, RECT_DUAL = 2, PORT_ASSIGNMENT = 3, VERIFY = 4, COMPACT = 5 };
     static void init(void);
     static void start(activity_t);
     static void stop(activity_t);
+    /* The time spent in each activity, summed over all threads.  With
+     * ALLOC_STATS, the number of allocations, the bytes allocated and the
+     * peak of the bytes in use during each activity follow the times. */
     static void print_times(std::ostream &);
+
+    /* Times the enclosing block as a phase, whose name is appended to those
+     * of the phases it is nested in on the same thread, as in
+     * "decompose/split".  A phase given an activity counts towards it, and the
+     * activity of the phase it is nested in is paused meanwhile. */
+    class scope {
+        size_t path_length;
+        int activity, outer_activity;
+        std::chrono::time_point<std::chrono::steady_clock> begin;
+        size_t begin_allocations, begin_bytes, outer_peak_live_bytes;
+        uint64_t begin_counters[max_perf_counters];
+        scope(const char *name, int act);
+    public:
+        explicit scope(const char *name) : scope(name, -1) {}
+        scope(const char *name, activity_t act) : scope(name, int(act)) {}
+        scope(const scope &) = delete;
+        ~scope();
+    };
+
+    /* Phases are only recorded after this was called, as recording costs an
+     * allocation per phase. */
+    static void record(void);
+    /* Opens the counters of perf_counters.hpp and from now on attributes them
+     * to each activity and phase.  Returns the number of counters. */
+    static size_t count_perf_events(void);
+    /* the time spent in each activity and each phase, summed per thread */
+    static void write_json(std::ostream &);
+    /* every phase as a complete event in the Chrome trace event format */
+    static void write_trace(std::ostream &);
+    /* the perf counters of each activity and phase as a tab-separated table */
+    static void write_counters(std::ostream &);
 };
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include "graph.hpp"
+#include "status.hpp"
+
+struct horizontal_segment_t { coord_t y, from, to; };
+struct vertical_segment_t   { coord_t x, from, to; };
+struct crossing_t { horizontal_segment_t h; vertical_segment_t v; };
+
+enum class check_mode_t : char { FIRST, COUNT, LIST };
+
+struct report_t
+{
+    size_t num_crossings = 0;
+    /* valid if num_crossings != 0 */
+    crossing_t first;
+    /* only filled in LIST mode */
+    std::vector<crossing_t> crossings;
+};
+
+std::ostream &operator<<(std::ostream &, const crossing_t &);
+
+report_t check_crossings(const graph_t &, const l_drawing_t &, check_mode_t = check_mode_t::FIRST, unsigned = 1);
+
+/* What check_crossings does not see, since it only counts proper crossings:
+ * fails if two vertices coincide, a vertex lies on another edge or two
+ * segments overlap or touch, as merging columns and rows could cause. */
+status_t check_extents(const graph_t &, const l_drawing_t &);
+
+status_t check_rect_dual(const graph_t &, const rectangular_dual_t &);
@@ -0,0 +1,397 @@
+#include <algorithm>
+#include <string>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include "include/io.hpp"
+
+/* Limits on the sizes in the header of a graph, so that invalid input cannot
+ * make the readers allocate much more memory than the input takes.  Planar
+ * graphs without multiple edges have fewer than 3n edges. */
+bool sizes_are_consistent(size_t num_vertices, size_t num_edges, size_t outer_face_degree)
+{
+    return num_edges <= 3 * num_vertices && outer_face_degree <= num_vertices;
+}
+
+/* The readers grow the vertices and labels of a reused graph as they reach
+ * them, instead of trusting the header, but keep those it already has. */
+void shrink_to(graph_t &graph, size_t num_vertices)
+{
+    graph.edges.clear();
+    graph.outer_face.clear();
+    if (graph.vertices.size() > num_vertices)
+        graph.vertices.resize(num_vertices);
+    if (graph.labels.size() > num_vertices)
+        graph.labels.resize(num_vertices);
+}
+
+status_t read_text_graph(std::istream &is, graph_t &out_graph)
+{
+    size_t line_num = 0;
+    auto error = [&]()
+    {
+        return fail(status_t::INVALID_INPUT, "Error reading input on line " + std::to_string(line_num));
+    };
+    std::string line;
+
+    /* header */
+    ++line_num;
+    std::getline(is, line);
+    size_t num_vertices, num_edges, outer_face_degree;
+    if (!(std::istringstream(line) >> num_vertices >> num_edges >> outer_face_degree)
+            || !sizes_are_consistent(num_vertices, num_edges, outer_face_degree))
+        return error();
+    shrink_to(out_graph, num_vertices);
+
+    /* outer face */
+    ++line_num;
+    std::getline(is, line);
+    std::istringstream iss(line);
+    vertex_t v1;
+    while (iss >> v1)
+    {
+        if (v1 == 0 || v1 > num_vertices || out_graph.outer_face.size() == outer_face_degree)
+            return error();
+        out_graph.outer_face.push_back(v1 - 1);
+    }
+
+    /* labels */
+    for (vertex_t v = 0; v < num_vertices; ++v)
+    {
+        ++line_num;
+        if (v == out_graph.labels.size())
+            out_graph.labels.emplace_back();
+        if (!std::getline(is, out_graph.labels[v]))
+            return error();
+    }
+
+    /* edges */
+    for (size_t e = 0; e < num_edges; ++e)
+    {
+        ++line_num;
+        std::getline(is, line);
+        vertex_t tail1, head1;
+        if (!(std::istringstream(line) >> tail1 >> head1)
+                || tail1 == 0 || tail1 > num_vertices || head1 == 0 || head1 > num_vertices)
+            return error();
+        out_graph.edges.push_back({ tail1 - 1, head1 - 1 });
+    }
+
+    /* embedding */
+    for (vertex_t v = 0; v < num_vertices; ++v)
+    {
+        ++line_num;
+        if (v == out_graph.vertices.size())
+            out_graph.vertices.emplace_back();
+        out_graph.vertices[v].clear();
+        if (!std::getline(is, line))
+            return error();
+        iss = std::istringstream(line);
+        size_t e1;
+        while (iss >> e1)
+        {
+            if (e1 == 0 || e1 > num_edges || out_graph.vertices[v].size() == num_edges)
+                return error();
+            out_graph.vertices[v].push_back(e1 - 1);
+        }
+    }
+
+    out_graph.update_neighbor_index();
+    return status_t::OK;
+}
+
+/* binary graphs start with this, see graph-format.md */
+const char binary_graph_magic[4] = { 'L', 'D', 'G', 'B' };
+const uint32_t binary_graph_labels = 0b1;
+
+status_t read_binary_graph(std::istream &is, graph_t &out_graph)
+{
+    auto error = [&]()
+    {
+        return fail(status_t::INVALID_INPUT, "Error reading binary graph");
+    };
+    /* large counts are read in blocks, so that memory only grows with the
+     * input that is actually there */
+    const size_t block_size = 1 << 16;
+    std::vector<unsigned char> bytes;
+    std::vector<uint32_t> values;
+    /* false at the end of the input */
+    auto read_u32s = [&](size_t count) -> bool
+    {
+        values.clear();
+        while (values.size() < count)
+        {
+            const size_t block = std::min(count - values.size(), block_size), offset = values.size();
+            bytes.resize(4 * block);
+            if (!is.read(reinterpret_cast<char *>(bytes.data()), bytes.size()))
+                return false;
+            values.resize(offset + block);
+            for (size_t i = 0; i < block; ++i)
+                values[offset + i] = uint32_t(bytes[4 * i]) | uint32_t(bytes[4 * i + 1]) << 8
+                    | uint32_t(bytes[4 * i + 2]) << 16 | uint32_t(bytes[4 * i + 3]) << 24;
+        }
+        return true;
+    };
+
+    char magic[sizeof binary_graph_magic];
+    if (!is.read(magic, sizeof magic) || !std::equal(magic, magic + sizeof magic, binary_graph_magic))
+        return error();
+    if (!read_u32s(4))
+        return error();
+    const size_t num_vertices = values[0], num_edges = values[1], outer_face_degree = values[2];
+    const uint32_t flags = values[3];
+    if (!sizes_are_consistent(num_vertices, num_edges, outer_face_degree))
+        return error();
+    shrink_to(out_graph, num_vertices);
+
+    if (!read_u32s(outer_face_degree))
+        return error();
+    for (uint32_t v : values)
+        if (v >= num_vertices)
+            return error();
+    out_graph.outer_face.assign(values.begin(), values.end());
+
+    if (flags & binary_graph_labels)
+        for (vertex_t v = 0; v < num_vertices; ++v)
+        {
+            if (!read_u32s(1))
+                return error();
+            if (v == out_graph.labels.size())
+                out_graph.labels.emplace_back();
+            std::string &label = out_graph.labels[v];
+            const size_t length = values[0];
+            label.clear();
+            while (label.size() < length)
+            {
+                const size_t block = std::min(length - label.size(), block_size), offset = label.size();
+                label.resize(offset + block);
+                if (!is.read(&label[offset], block))
+                    return error();
+            }
+        }
+
+    if (!read_u32s(2 * num_edges))
+        return error();
+    for (size_t e = 0; e < num_edges; ++e)
+    {
+        if (values[2 * e] >= num_vertices || values[2 * e + 1] >= num_vertices)
+            return error();
+        out_graph.edges.push_back({ values[2 * e], values[2 * e + 1] });
+    }
+
+    for (vertex_t v = 0; v < num_vertices; ++v)
+    {
+        if (!read_u32s(1) || values[0] > num_edges || !read_u32s(values[0]))
+            return error();
+        if (v == out_graph.vertices.size())
+            out_graph.vertices.emplace_back();
+        for (uint32_t e : values)
+            if (e >= num_edges)
+                return error();
+        out_graph.vertices[v].assign(values.begin(), values.end());
+    }
+
+    /* only now that the input has shown that there are num_vertices of them */
+    if (!(flags & binary_graph_labels))
+    {
+        out_graph.labels.resize(num_vertices);
+        for (vertex_t v = 0; v < num_vertices; ++v)
+            out_graph.labels[v] = std::to_string(v + 1);
+    }
+
+    out_graph.update_neighbor_index();
+    return status_t::OK;
+}
+
+status_t read_graph(std::istream &is, graph_t &out_graph)
+{
+    if (is.peek() == binary_graph_magic[0])
+        return read_binary_graph(is, out_graph);
+    else
+        return read_text_graph(is, out_graph);
+}
+
+void write_graph(std::ostream &os, const graph_t &graph)
+{
+    buffered_writer out(os);
+    out.put_uint(graph.num_vertices());
+    out.put(' ');
+    out.put_uint(graph.num_edges());
+    out.put(' ');
+    out.put_uint(graph.outer_face.size());
+    out.put('\n');
+    for (size_t i = 0; i < graph.outer_face.size(); ++i)
+    {
+        if (i != 0)
+            out.put(' ');
+        out.put_uint(graph.outer_face[i] + 1);
+    }
+    out.put('\n');
+    for (const std::string &label : graph.labels)
+    {
+        out.put(label);
+        out.put('\n');
+    }
+    for (const edge_t &e : graph.edges)
+    {
+        out.put_uint(e.tail + 1);
+        out.put(' ');
+        out.put_uint(e.head + 1);
+        out.put('\n');
+    }
+    for (const auto &rotation : graph.vertices)
+    {
+        for (size_t e : rotation)
+        {
+            out.put_uint(e + 1);
+            out.put(' ');
+        }
+        out.put('\n');
+    }
+}
+
+void write_binary_graph(std::ostream &os, const graph_t &graph)
+{
+    bool default_labels = true;
+    for (vertex_t v = 0; v < graph.num_vertices() && default_labels; ++v)
+        default_labels = graph.labels[v] == std::to_string(v + 1);
+
+    buffered_writer out(os);
+    for (char c : binary_graph_magic)
+        out.put(c);
+    out.put_u32(graph.num_vertices());
+    out.put_u32(graph.num_edges());
+    out.put_u32(graph.outer_face.size());
+    out.put_u32(default_labels ? 0 : binary_graph_labels);
+    for (vertex_t v : graph.outer_face)
+        out.put_u32(v);
+    if (!default_labels)
+        for (const std::string &label : graph.labels)
+        {
+            out.put_u32(label.size());
+            out.put(label);
+        }
+    for (const edge_t &e : graph.edges)
+    {
+        out.put_u32(e.tail);
+        out.put_u32(e.head);
+    }
+    for (const auto &rotation : graph.vertices)
+    {
+        out.put_u32(rotation.size());
+        for (size_t e : rotation)
+            out.put_u32(e);
+    }
+}
+
+/* packed codes start with this, followed by the number of bits as 64-bit
+ * little-endian integer and the bits, eight per byte, least significant first */
+const char packed_code_magic[4] = { 'P', 'S', 'C', '1' };
+
+status_t read_code(std::istream &is, std::vector<bool> &out_bitstring)
+{
+    auto error = [&]()
+    {
+        return fail(status_t::INVALID_INPUT, "Error reading code");
+    };
+    out_bitstring.clear();
+
+    is >> std::ws;
+    if (is.peek() == packed_code_magic[0])
+    {
+        char magic[sizeof packed_code_magic];
+        unsigned char length_bytes[8];
+        if (!is.read(magic, sizeof magic) || !std::equal(magic, magic + sizeof magic, packed_code_magic)
+                || !is.read(reinterpret_cast<char *>(length_bytes), sizeof length_bytes))
+            return error();
+        unsigned long long length = 0;
+        for (int i = 7; i >= 0; --i)
+            length = length << 8 | length_bytes[i];
+        /* in blocks, so that a wrong length cannot allocate more than the
+         * input takes */
+        char bytes[1 << 16];
+        while (out_bitstring.size() < length)
+        {
+            const size_t block = std::min<unsigned long long>((length - out_bitstring.size() + 7) / 8, sizeof bytes);
+            if (!is.read(bytes, block))
+                return error();
+            for (size_t i = 0; i < 8 * block && out_bitstring.size() < length; ++i)
+                out_bitstring.push_back(bytes[i / 8] >> (i % 8) & 1);
+        }
+        return status_t::OK;
+    }
+
+    char c;
+    while (is >> c)
+    {
+        if (c != '0' && c != '1')
+            return error();
+        out_bitstring.push_back(c == '1');
+    }
+    return status_t::OK;
+}
+
+void write_packed_code(std::ostream &os, const std::vector<bool> &bitstring)
+{
+    os.write(packed_code_magic, sizeof packed_code_magic);
+    unsigned long long length = bitstring.size();
+    for (int i = 0; i < 8; ++i)
+        os.put(char(length >> 8 * i & 0xff));
+    std::vector<char> bytes((bitstring.size() + 7) / 8, 0);
+    for (size_t i = 0; i < bitstring.size(); ++i)
+        if (bitstring[i])
+            bytes[i / 8] |= char(1 << i % 8);
+    os.write(bytes.data(), bytes.size());
+    os.flush();
+}
+
+void write_raw(std::ostream &os, const l_drawing_t &drawing)
+{
+    buffered_writer out(os);
+    for (const auto &v : drawing)
+    {
+        out.put_uint(v.x);
+        out.put(' ');
+        out.put_uint(v.y);
+        out.put('\n');
+    }
+}
+
+void write_raw(std::ostream &os, const rectangular_dual_t &drawing)
+{
+    for (const auto &v : drawing)
+        os << v.x_min << ' ' << v.y_min << ' ' << v.x_max << ' ' << v.y_max << std::endl;
+}
+
+void write_latex_header(std::ostream &os)
+{
+    os  << "\\documentclass{article}\n"
+        << "\\usepackage{tikz}\n"
+        << "\\begin{document}" << std::endl;
+}
+
+void write_tikz(std::ostream &os, const graph_t &graph, const l_drawing_t &drawing)
+{
+    os  << "\\resizebox{\\textwidth}{!}{\\begin{tikzpicture}\n";
+    for (vertex_t v = 0; v < graph.num_vertices(); ++v)
+        os  << "\\node (" << v + 1 << ") at ("
+            << drawing[v].x << ',' << drawing[v].y << ") {" << graph.labels[v] << "};\n";
+    for (const edge_t &e : graph.edges)
+        os  << "\\draw[rounded corners] (" << e.tail + 1 << ") |- (" << e.head + 1 << ");\n";
+    os << "\\end{tikzpicture}}" << std::endl;
+}
+
+void write_tikz(std::ostream &os, const graph_t &graph, const rectangular_dual_t &drawing)
+{
+    os  << "\\resizebox{\\textwidth}{!}{\\begin{tikzpicture}\n";
+    for (vertex_t v = 0; v < drawing.size(); ++v)
+        os  << "\\draw[rounded corners] (" << drawing[v].x_min << ',' << drawing[v].y_min
+            << ") rectangle node {" << graph.labels[v] << "} (" << drawing[v].x_max
+            << ',' << drawing[v].y_max << ");\n";
+    os << "\\end{tikzpicture}}" << std::endl;
+}
+
+void write_latex_footer(std::ostream &os)
+{
+    os << "\\end{document}" << std::endl;
+}
@@ -0,0 +1,82 @@
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+void usage(char *name)
+{
+    std::cerr << "usage: " << name << " [ --stats ] [ --stall seconds ] socket" << std::endl;
+    exit(1);
+}
+
+/* Sends the graph on stdin, or a request for the latency histogram, to
+ * ldrawingd and writes the response to stdout.  With --stall, it waits before
+ * reading the response, like a slow client. */
+int main(int argc, char **argv)
+{
+    bool stats = false;
+    unsigned stall_seconds = 0;
+    const char *socket_path = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg(argv[i]);
+        if (arg == "--stats")
+            stats = true;
+        else if (arg == "--stall" && i + 1 < argc)
+        {
+            if (!(std::istringstream(argv[++i]) >> stall_seconds))
+                usage(argv[0]);
+        }
+        else if (i + 1 == argc)
+            socket_path = argv[i];
+        else
+            usage(argv[0]);
+    }
+    if (socket_path == nullptr)
+        usage(argv[0]);
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (std::strlen(socket_path) >= sizeof address.sun_path)
+        usage(argv[0]);
+    std::strcpy(address.sun_path, socket_path);
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof address) != 0)
+    {
+        std::cerr << "Cannot connect to " << socket_path << ": " << std::strerror(errno) << ". Exiting." << std::endl;
+        exit(1);
+    }
+
+    const std::string request = stats ? std::string("STATS\n")
+        : std::string(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+    for (size_t written = 0; written < request.size(); )
+    {
+        const ssize_t count = write(fd, request.data() + written, request.size() - written);
+        if (count <= 0)
+        {
+            std::cerr << "Cannot send request. Exiting." << std::endl;
+            exit(1);
+        }
+        written += count;
+    }
+    shutdown(fd, SHUT_WR);
+    sleep(stall_seconds);
+
+    char buffer[65536];
+    ssize_t count;
+    size_t received = 0;
+    while ((count = read(fd, buffer, sizeof buffer)) > 0)
+    {
+        std::cout.write(buffer, count);
+        received += count;
+    }
+    close(fd);
+
+    /* the daemon closes the connection without a response if it failed */
+    return received == 0;
+}
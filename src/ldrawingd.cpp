@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "include/draw.hpp"
+
+/* Latencies of the requests, from accepting the connection until the response
+ * was written.  Bucket i counts those of 2^i to 2^(i+1)-1 microseconds. */
+const size_t num_latency_buckets = 40;
+std::atomic<size_t> latency_histogram[num_latency_buckets];
+
+const char *socket_path = nullptr;
+
+void on_signal(int)
+{
+    unlink(socket_path);
+    _exit(0);
+}
+
+/* Requests larger than this are rejected, as are clients that take longer
+ * than the timeout to send their request or to take the response, so that no
+ * client can hold a worker forever. */
+size_t max_request_size = size_t(1) << 28;
+unsigned timeout_seconds = 10;
+
+typedef std::chrono::steady_clock::time_point time_point_t;
+
+/* Sets the timeout of the socket option SO_RCVTIMEO or SO_SNDTIMEO to the
+ * time left until the deadline, and fails if there is none left. */
+status_t set_timeout(int fd, int option, time_point_t deadline)
+{
+    const auto remaining = std::chrono::duration_cast<std::chrono::microseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+    if (remaining <= 0)
+        return fail(status_t::INVALID_INPUT, "Connection timed out");
+    const timeval timeout{ time_t(remaining / 1000000), suseconds_t(remaining % 1000000) };
+    if (setsockopt(fd, SOL_SOCKET, option, &timeout, sizeof timeout) != 0)
+        return fail(status_t::INVALID_INPUT, "Cannot set timeout: " + std::string(std::strerror(errno)));
+    return status_t::OK;
+}
+
+/* reads until the client shuts down its end, within the timeout in total */
+status_t read_request(int fd, std::string &out_request)
+{
+    char buffer[65536];
+    out_request.clear();
+    const time_point_t deadline = std::chrono::steady_clock::now() + std::chrono::seconds(timeout_seconds);
+    while (true)
+    {
+        if (set_timeout(fd, SO_RCVTIMEO, deadline) != status_t::OK)
+            return status_t::INVALID_INPUT;
+        const ssize_t count = read(fd, buffer, sizeof buffer);
+        if (count == 0)
+            return status_t::OK;
+        if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return fail(status_t::INVALID_INPUT, "Request timed out");
+        if (count < 0)
+            return fail(status_t::INVALID_INPUT, "Cannot read request: " + std::string(std::strerror(errno)));
+        if (out_request.size() + count > max_request_size)
+            return fail(status_t::INVALID_INPUT, "Request is larger than " + std::to_string(max_request_size) + " bytes");
+        out_request.append(buffer, count);
+    }
+}
+
+/* writes everything within the timeout in total */
+status_t write_response(int fd, const std::string &response)
+{
+    const time_point_t deadline = std::chrono::steady_clock::now() + std::chrono::seconds(timeout_seconds);
+    for (size_t written = 0; written < response.size(); )
+    {
+        if (set_timeout(fd, SO_SNDTIMEO, deadline) != status_t::OK)
+            return status_t::INVALID_INPUT;
+        const ssize_t count = write(fd, response.data() + written, response.size() - written);
+        if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return fail(status_t::INVALID_INPUT, "Response timed out");
+        if (count <= 0)
+            return fail(status_t::INVALID_INPUT, "Cannot write response: " + std::string(std::strerror(errno)));
+        written += count;
+    }
+    return status_t::OK;
+}
+
+void write_latencies(std::ostream &os)
+{
+    size_t num_requests = 0;
+    for (const auto &bucket : latency_histogram)
+        num_requests += bucket;
+    os << "{\n  \"requests\": " << num_requests << ",\n  \"latency_us\": {";
+    bool first = true;
+    for (size_t bucket = 0; bucket < num_latency_buckets; ++bucket)
+        if (latency_histogram[bucket] != 0)
+        {
+            os << (first ? " \"" : ", \"") << (size_t(1) << bucket) << "\": " << latency_histogram[bucket];
+            first = false;
+        }
+    os << " }\n}" << std::endl;
+}
+
+struct connection_t {
+    int fd;
+    std::chrono::steady_clock::time_point accepted;
+};
+
+std::mutex queue_mutex;
+std::condition_variable queue_not_empty;
+std::queue<connection_t> connections;
+
+/* Handles one connection at a time.  The request, drawing context and
+ * response of each worker are kept from one request to the next, so that a
+ * warm worker mostly reuses their memory. */
+void work(const draw_options_t &options)
+{
+    std::string request;
+    drawing_context_t context;
+    std::ostringstream response;
+    while (true)
+    {
+        connection_t connection;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_not_empty.wait(lock, []() { return !connections.empty(); });
+            connection = connections.front();
+            connections.pop();
+        }
+
+        /* whatever goes wrong, only this request fails */
+        status_t status = status_t::OK;
+        try
+        {
+            response.str("");
+            status = read_request(connection.fd, request);
+            if (status == status_t::OK && request.compare(0, 5, "STATS") == 0)
+                write_latencies(response);
+            else if (status == status_t::OK)
+            {
+                std::istringstream is(request);
+                status = context.read(is);
+                if (status == status_t::OK)
+                    status = draw(context, context.graph, response, options);
+            }
+        }
+        catch (const std::exception &e)
+        {
+            status = fail(status_t::INVALID_INPUT, e.what());
+        }
+        if (status == status_t::OK)
+            status = write_response(connection.fd, response.str());
+        if (status != status_t::OK)
+            std::cerr << "Request failed: " << error_message() << std::endl;
+        close(connection.fd);
+
+        const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - connection.accepted).count();
+        size_t bucket = 0;
+        while (bucket + 1 < num_latency_buckets && latency >> (bucket + 1) != 0)
+            ++bucket;
+        ++latency_histogram[bucket];
+    }
+}
+
+void usage(char *name)
+{
+    std::cerr << "usage: " << name << " [ --threads n ] [ --timeout seconds ] [ --max-request-size bytes ] [ --level-order ] [ --compact ] [ --verify ] [ --rect-dual ] [ --tikz ] socket" << std::endl;
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    draw_options_t options{ false, false, false, false, false, false, false, 1 };
+    unsigned num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg(argv[i]);
+        if (arg == "--rect-dual")
+            options.rect_dual = true;
+        else if (arg == "--tikz")
+            options.tikz = true;
+        else if (arg == "--level-order")
+            options.level_order = true;
+        else if (arg == "--compact")
+            options.compact = true;
+        else if (arg == "--verify")
+            options.verify = true;
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            if (!(std::istringstream(argv[++i]) >> num_threads) || num_threads == 0)
+                usage(argv[0]);
+        }
+        else if (arg == "--timeout" && i + 1 < argc)
+        {
+            if (!(std::istringstream(argv[++i]) >> timeout_seconds) || timeout_seconds == 0)
+                usage(argv[0]);
+        }
+        else if (arg == "--max-request-size" && i + 1 < argc)
+        {
+            if (!(std::istringstream(argv[++i]) >> max_request_size) || max_request_size == 0)
+                usage(argv[0]);
+        }
+        else if (i + 1 == argc)
+            socket_path = argv[i];
+        else
+            usage(argv[0]);
+    }
+    if (socket_path == nullptr)
+        usage(argv[0]);
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (std::strlen(socket_path) >= sizeof address.sun_path)
+    {
+        std::cerr << "Socket path is too long. Exiting." << std::endl;
+        exit(1);
+    }
+    std::strcpy(address.sun_path, socket_path);
+    const int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socket_path);
+    if (listen_fd < 0 || bind(listen_fd, reinterpret_cast<sockaddr *>(&address), sizeof address) != 0
+            || listen(listen_fd, SOMAXCONN) != 0)
+    {
+        std::cerr << "Cannot listen on " << socket_path << ": " << std::strerror(errno) << ". Exiting." << std::endl;
+        exit(1);
+    }
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+    /* a client that goes away must not kill the daemon */
+    std::signal(SIGPIPE, SIG_IGN);
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < num_threads; ++t)
+        workers.emplace_back(work, std::cref(options));
+
+    while (true)
+    {
+        const int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0)
+            continue;
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            connections.push({ fd, std::chrono::steady_clock::now() });
+        }
+        queue_not_empty.notify_one();
+    }
+}
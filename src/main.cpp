@@ -1,176 +1,249 @@
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
 #include <string>
 #include <iostream>
+#include <mutex>
 #include <sstream>
+#include <thread>
 #include <vector>
-#include "include/port_assignment.hpp"
-#include "include/rectangular_dual.hpp"
-#include "include/decompose.hpp"
+#include "include/draw.hpp"
 #include "include/io.hpp"
 #include "include/timer.hpp"
+#include "include/sampling.hpp"
 
-graph_t read_graph(std::istream &is)
+void usage(char *name)
 {
-    graph_t out_graph;
-    size_t line_num = 0;
-    auto error = [&]()
-    {
-        std::cerr << "Error reading input on line " << line_num << std::endl;
-        exit(1);
-    };
-    std::string line;
-
-    /* header */
-    ++line_num;
-    std::getline(is, line);
-    size_t num_vertices, num_edges, outer_face_degree;
-    if (!(std::istringstream(line) >> num_vertices >> num_edges >> outer_face_degree))
-        error();
-    out_graph.vertices.clear();
-    out_graph.edges.clear();
-    out_graph.labels.clear();
-    out_graph.outer_face.clear();
-    out_graph.vertices.resize(num_vertices);
-    out_graph.edges.reserve(num_edges);
-    out_graph.labels.reserve(num_vertices);
-    out_graph.outer_face.reserve(outer_face_degree);
-
-    /* outer face */
-    ++line_num;
-    std::getline(is, line);
-    std::istringstream iss(line);
-    vertex_t v1;
-    while (iss >> v1)
-        out_graph.outer_face.push_back(v1 - 1);
-
-    /* labels */
-    for (vertex_t v = 0; v < num_vertices; ++v)
-    {
-        ++line_num;
-        std::getline(is, line);
-        out_graph.labels.push_back(line);
-    }
-
-    /* edges */
-    for (size_t e = 0; e < num_edges; ++e)
-    {
-        ++line_num;
-        std::getline(is, line);
-        vertex_t tail1, head1;
-        if (!(std::istringstream(line) >> tail1 >> head1))
-            error();
-        out_graph.edges.push_back({ tail1 - 1, head1 - 1 });
-    }
-
-    /* embedding */
-    for (vertex_t v = 0; v < num_vertices; ++v)
-    {
-        ++line_num;
-        std::getline(is, line);
-        iss = std::istringstream(line);
-        size_t e1;
-        while (iss >> e1)
-            out_graph.vertices[v].push_back(e1 - 1);
-    }
-
-    out_graph.update_neighbor_index();
-
-    return out_graph;
+    std::cerr << "usage: " << name << " [ --time ] [ --time-json file ] [ --trace file ] [ --perf-counters ] [ --stats ] [ --threads n ] [ --batch ] [ --level-order ] [ --compact ] [ --verify ] [ --code ] [ --rect-dual ] [ [ --print-duals ] --tikz ]" << std::endl;
+    exit(1);
 }
 
-void write_raw(std::ostream &os, const l_drawing_t &drawing)
+void fail_and_exit(void)
 {
-    for (const auto &v : drawing)
-        os << v.x << ' ' << v.y << std::endl;
+    std::cerr << error_message() << ". Exiting." << std::endl;
+    exit(1);
 }
 
-void write_raw(std::ostream &os, const rectangular_dual_t &drawing)
+/* Draws every graph in the stream, followed by an empty line.  Chunks of
+ * graphs are read on this thread and drawn concurrently by it and the other
+ * workers, each into its own buffer, and the buffers are then written in the
+ * order of the graphs.  The workers last for the whole stream, the graphs of a
+ * chunk are reused for the next one, and each worker keeps its context.
+ *
+ * A graph that cannot be drawn gets the line "error: " and the message
+ * instead of its drawing, and the others are still drawn.  If a graph cannot
+ * be read, the graphs before it are drawn and written, and the rest of the
+ * stream is ignored. */
+status_t draw_batch(std::istream &is, std::ostream &os, const draw_options_t &options, unsigned num_threads)
 {
-    for (const auto &v : drawing)
-        os << v.x_min << ' ' << v.y_min << ' ' << v.x_max << ' ' << v.y_max << std::endl;
-}
+    const size_t chunk_size = 16 * num_threads;
+    std::vector<graph_t> graphs(chunk_size);
+    std::vector<std::ostringstream> outputs(chunk_size);
+    std::vector<drawing_context_t> contexts(num_threads);
+
+    /* the chunk in graphs[0..count) is number generation, and busy workers
+     * other than this thread are still drawing it */
+    std::mutex mutex;
+    std::condition_variable chunk_read, chunk_drawn;
+    size_t count = 0, generation = 0;
+    unsigned busy = 0;
+    bool end_of_stream = false;
+    std::atomic<size_t> next_graph(0), num_failed(0);
+
+    auto draw_chunk = [&](unsigned t)
+    {
+        for (size_t i; (i = next_graph++) < count; )
+        {
+            outputs[i].str("");
+            if (draw(contexts[t], graphs[i], outputs[i], options) != status_t::OK)
+            {
+                outputs[i].str("");
+                outputs[i] << "error: " << error_message() << '\n';
+                ++num_failed;
+            }
+            outputs[i] << '\n';
+        }
+    };
+    auto work = [&](unsigned t)
+    {
+        for (size_t drawn = 0; ; ++drawn)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                chunk_read.wait(lock, [&]() { return generation != drawn || end_of_stream; });
+                if (end_of_stream)
+                    return;
+            }
+            draw_chunk(t);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--busy == 0)
+                chunk_drawn.notify_one();
+        }
+    };
+    std::vector<std::thread> threads;
+    for (unsigned t = 1; t < num_threads; ++t)
+        threads.emplace_back(work, t);
 
-void write_latex_header(std::ostream &os)
-{
-    os  << "\\documentclass{article}\n"
-        << "\\usepackage{tikz}\n"
-        << "\\begin{document}" << std::endl;
-}
+    status_t read_status = status_t::OK;
+    std::string read_error;
+    do
+    {
+        size_t num_read = 0;
+        {
+            timer::scope phase("read", timer::IO);
+            while (num_read < chunk_size && (is >> std::ws).peek() != EOF)
+            {
+                read_status = read_graph(is, graphs[num_read]);
+                if (read_status != status_t::OK)
+                {
+                    /* drawing on this thread may set another message */
+                    read_error = error_message();
+                    break;
+                }
+                ++num_read;
+            }
+        }
 
-void write_tikz(std::ostream &os, const graph_t &graph, const l_drawing_t &drawing)
-{
-    os  << "\\resizebox{\\textwidth}{!}{\\begin{tikzpicture}\n";
-    for (vertex_t v = 0; v < graph.num_vertices(); ++v)
-        os  << "\\node (" << v + 1 << ") at ("
-            << drawing[v].x << ',' << drawing[v].y << ") {" << graph.labels[v] << "};\n";
-    for (const edge_t &e : graph.edges)
-        os  << "\\draw[rounded corners] (" << e.tail + 1 << ") |- (" << e.head + 1 << ");\n";
-    os << "\\end{tikzpicture}}" << std::endl;
-}
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            count = num_read;
+            next_graph = 0;
+            busy = num_threads - 1;
+            ++generation;
+        }
+        chunk_read.notify_all();
+        draw_chunk(0);
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            chunk_drawn.wait(lock, [&]() { return busy == 0; });
+        }
 
-void write_tikz(std::ostream &os, const graph_t &graph, const rectangular_dual_t &drawing)
-{
-    os  << "\\resizebox{\\textwidth}{!}{\\begin{tikzpicture}\n";
-    for (vertex_t v = 0; v < drawing.size(); ++v)
-        os  << "\\draw[rounded corners] (" << drawing[v].x_min << ',' << drawing[v].y_min
-            << ") rectangle node {" << graph.labels[v] << "} (" << drawing[v].x_max
-            << ',' << drawing[v].y_max << ");\n";
-    os << "\\end{tikzpicture}}" << std::endl;
-}
+        timer::scope phase("write", timer::IO);
+        for (size_t i = 0; i < count; ++i)
+            os << outputs[i].str();
+        os.flush();
+    } while (count == chunk_size && read_status == status_t::OK);
 
-void write_latex_footer(std::ostream &os)
-{
-    os << "\\end{document}" << std::endl;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        end_of_stream = true;
+    }
+    chunk_read.notify_all();
+    for (std::thread &thread : threads)
+        thread.join();
+
+    if (read_status != status_t::OK)
+        return fail(read_status, read_error);
+    if (num_failed != 0)
+        return fail(status_t::NOT_DRAWABLE, "Could not draw " + std::to_string(num_failed) + " of the graphs");
+    return status_t::OK;
 }
 
 int main(int argc, char **argv)
 {
-    timer::start(timer::IO);
-    graph_t graph = read_graph(std::cin);
-    timer::stop(timer::IO);
-
-    const bool tikz = (std::string(argv[argc - 1]) == std::string("--tikz"));
-    if (argc >= 2 && std::string(argv[1]) == std::string("--rect-dual"))
+    draw_options_t options{ false, false, false, false, false, false, false, 1 };
+    bool time = false, code = false, perf_counters = false, batch = false;
+    const char *json_file = nullptr, *trace_file = nullptr;
+    for (int i = 1; i < argc; ++i)
     {
-        timer::start(timer::RECT_DUAL);
-        rectangular_dual_t drawing = compute_rect_dual(graph);
-        timer::stop(timer::RECT_DUAL);
-
-        timer::start(timer::IO);
-        if (tikz)
+        const std::string arg(argv[i]);
+        if (arg == "--rect-dual")
+            options.rect_dual = true;
+        else if (arg == "--print-duals")
+            options.print_duals = true;
+        else if (arg == "--tikz")
+            options.tikz = true;
+        else if (arg == "--time")
+            time = true;
+        else if (arg == "--time-json" && i + 1 < argc)
+            json_file = argv[++i];
+        else if (arg == "--trace" && i + 1 < argc)
+            trace_file = argv[++i];
+        else if (arg == "--perf-counters")
+            perf_counters = true;
+        else if (arg == "--stats")
+            options.stats = true;
+        else if (arg == "--batch")
+            batch = true;
+        else if (arg == "--level-order")
+            options.level_order = true;
+        else if (arg == "--compact")
+            options.compact = true;
+        else if (arg == "--verify")
+            options.verify = true;
+        else if (arg == "--code")
+            code = true;
+        else if (arg == "--threads" && i + 1 < argc)
         {
-            write_latex_header(std::cout);
-            write_tikz(std::cout, graph, drawing);
-            write_latex_footer(std::cout);
+            if (!(std::istringstream(argv[++i]) >> options.num_threads) || options.num_threads == 0)
+                usage(argv[0]);
         }
         else
-            write_raw(std::cout, drawing);
-        timer::stop(timer::IO);
+            usage(argv[0]);
     }
-    else
-    {
-        const bool print_duals = tikz && std::string(argv[1]) == std::string("--print-duals");
-        timer::start(timer::DECOMPOSE);
-        four_block_tree_t four_block_tree = build_four_block_tree(graph);
-        timer::stop(timer::DECOMPOSE);
+    options.print_duals = options.print_duals && options.tikz;
+    /* the duals and statistics of concurrent drawings would be interleaved */
+    if (batch && (code || options.print_duals || options.stats))
+        usage(argv[0]);
 
-        if (tikz)
-            write_latex_header(std::cout);
-
-        l_drawing_t drawing = construct_drawing(graph, four_block_tree, print_duals);
+    if (perf_counters && timer::count_perf_events() == 0)
+    {
+        std::cerr << "Cannot open any performance counters. Exiting." << std::endl;
+        exit(1);
+    }
+    if (json_file != nullptr || trace_file != nullptr || perf_counters)
+        timer::record();
 
-        timer::start(timer::IO);
-        if (tikz)
+    if (batch)
+    {
+        /* the threads draw one graph each */
+        const unsigned num_threads = options.num_threads;
+        options.num_threads = 1;
+        if (draw_batch(std::cin, std::cout, options, num_threads) != status_t::OK)
+            fail_and_exit();
+    }
+    else
+    {
+        drawing_context_t context;
+        graph_t &graph = context.graph;
         {
-            write_tikz(std::cout, graph, drawing);
-            write_latex_footer(std::cout);
+            timer::scope phase("read", timer::IO);
+            if (code)
+            {
+                std::vector<bool> bitstring;
+                if (read_code(std::cin, bitstring) != status_t::OK)
+                    fail_and_exit();
+                if (code_size(bitstring) == 0)
+                {
+                    std::cerr << "Code must have length 4n-2 and contain n-1 ones, for some n >= 2" << std::endl;
+                    exit(1);
+                }
+                graph = decode_triangulation(bitstring);
+            }
+            else if (context.read(std::cin) != status_t::OK)
+                fail_and_exit();
         }
-        else
-            write_raw(std::cout, drawing);
-        timer::stop(timer::IO);
+
+        if (draw(context, graph, std::cout, options) != status_t::OK)
+            fail_and_exit();
+        if (options.stats && !options.rect_dual)
+            write_stats(std::cerr, context.stats, context.counts, context.drawing);
     }
 
-    if (argc >= 2 && std::string(argv[1]) == std::string("--time"))
+    if (time)
         timer::print_times(std::cerr);
+    if (perf_counters)
+        timer::write_counters(std::cerr);
+    if (json_file != nullptr)
+    {
+        std::ofstream ofs(json_file);
+        timer::write_json(ofs);
+    }
+    if (trace_file != nullptr)
+    {
+        std::ofstream ofs(trace_file);
+        timer::write_trace(ofs);
+    }
 
     return 0;
 }
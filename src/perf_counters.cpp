@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "include/perf_counters.hpp"
+
+struct perf_event_t {
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+};
+
+const perf_event_t hardware_events[] = {
+    { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { "cache_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { "branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+};
+
+const perf_event_t software_events[] = {
+    { "task_clock_ns", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+    { "context_switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+    { "cpu_migrations", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS },
+};
+
+const perf_event_t page_faults = { "page_faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS };
+
+/* the events opened by open_perf_counters, which every thread counts */
+std::vector<const perf_event_t *> perf_events;
+std::vector<std::string> perf_names;
+
+/* Opens the event for the calling thread only, in the group of leader_fd
+ * unless that is -1, in which case the event leads a new group. */
+int open_perf_counter(const perf_event_t &event, int leader_fd)
+{
+    struct perf_event_attr attr;
+    std::memset(&attr, 0, sizeof attr);
+    attr.size = sizeof attr;
+    attr.type = event.type;
+    attr.config = event.config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, leader_fd, 0);
+}
+
+/* The counters of one thread, opened the first time it reads them and closed
+ * when it ends.  The first is the leader of the group. */
+struct thread_counters_t {
+    std::vector<int> fds;
+    bool opened = false;
+
+    void open(void)
+    {
+        opened = true;
+        for (const perf_event_t *event : perf_events)
+        {
+            const int fd = open_perf_counter(*event, fds.empty() ? -1 : fds[0]);
+            if (fd < 0)
+            {
+                close_all();
+                return;
+            }
+            fds.push_back(fd);
+        }
+    }
+
+    void close_all(void)
+    {
+        for (int fd : fds)
+            close(fd);
+        fds.clear();
+    }
+
+    ~thread_counters_t() { close_all(); }
+};
+
+thread_local thread_counters_t thread_counters;
+
+size_t open_perf_counters(void)
+{
+    if (!perf_events.empty())
+        return perf_events.size();
+    /* the events that can be counted together in one group */
+    std::vector<int> &fds = thread_counters.fds;
+    auto try_event = [&](const perf_event_t &event)
+    {
+        if (perf_events.size() == max_perf_counters)
+            return;
+        const int fd = open_perf_counter(event, fds.empty() ? -1 : fds[0]);
+        if (fd < 0)
+            return;
+        fds.push_back(fd);
+        perf_events.push_back(&event);
+        perf_names.push_back(event.name);
+    };
+    for (const perf_event_t &event : hardware_events)
+        try_event(event);
+    if (perf_events.empty())
+        for (const perf_event_t &event : software_events)
+            try_event(event);
+    try_event(page_faults);
+    thread_counters.opened = true;
+    return perf_events.size();
+}
+
+const std::vector<std::string> &perf_counter_names(void)
+{
+    return perf_names;
+}
+
+void read_perf_counters(uint64_t *out)
+{
+    if (!thread_counters.opened)
+        thread_counters.open();
+    /* the number of counters followed by their values */
+    uint64_t values[1 + max_perf_counters];
+    const size_t num_counters = perf_events.size(), size = (1 + num_counters) * sizeof values[0];
+    if (thread_counters.fds.empty() || read(thread_counters.fds[0], values, size) != ssize_t(size))
+    {
+        std::fill(out, out + num_counters, 0);
+        return;
+    }
+    std::copy(values + 1, values + 1 + num_counters, out);
+}
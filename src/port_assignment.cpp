@@ -1,10 +1,15 @@
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <set>
+#include <thread>
 #include "include/graph.hpp"
 #include "include/rectangular_dual.hpp"
 #include "include/port_assignment.hpp"
 #include "include/debug_print.hpp"
 #include "include/io.hpp"
 #include "include/timer.hpp"
+#include "include/stats.hpp"
 
 enum direction_t : size_t { RIGHT = 0, TOP = 1, LEFT = 2, BOTTOM = 3 };
 std::ostream &operator<<(std::ostream &os, direction_t dir)
@@ -27,27 +32,9 @@ std::ostream &operator<<(std::ostream &os, direction_t dir)
     return os;
 }
 
-/* H_SHAPE: TTT
- *          X W
- *          SSS
- * cases a, d, h, y use this
- *
- * LONG_SINK: TXW
- *            T W
- *            TSS
- * case b uses this
- *
- * T_SHAPE: TXW
- *          T W
- *          SSS
- * cases e, g, x use this
- *
- * LONG_SOURCE: WXS
- *              W S
- *              TTS
- * case f uses this
- */
-enum class outer_face_t : char { H_SHAPE, LONG_SINK, T_SHAPE, LONG_SOURCE };
+/* minimum number of vertices per thread for the port assignment of a
+ * component to be split among threads */
+const size_t parallel_threshold = 4096;
 
 void get_edge_info(const rectangular_dual_t &dual, const edge_t &edge, vertex_t vertex,
         vertex_t &out_other, bool &out_outgoing, direction_t &out_direction)
@@ -64,24 +51,23 @@ void get_edge_info(const rectangular_dual_t &dual, const edge_t &edge, vertex_t
         out_direction = direction_t::BOTTOM;
 }
 
-void port_assignment(const four_connected_component_t &graph, const rectangular_dual_t &dual, port_assignment_t *out_pa)
+void port_assignment(const four_connected_component_t &graph, const rectangular_dual_t &dual, port_assignment_t *out_pa, unsigned num_threads, drawing_counts_t &out_counts)
 {
     enum class switch_t { ANY, CLOCKWISE, COUNTER_CLOCKWISE };
-    std::vector<std::pair<vertex_t, switch_t>> postponed_vertices;
-    for (vertex_t tentative_v = 0; tentative_v < graph.num_vertices(); tentative_v += postponed_vertices.empty())
-    {
-        vertex_t v = tentative_v;
-        switch_t switch_direction = switch_t::ANY;
-        if (!postponed_vertices.empty())
-        {
-            v = postponed_vertices.back().first;
-            switch_direction = postponed_vertices.back().second;
-            postponed_vertices.pop_back();
-        }
+    typedef std::vector<std::pair<vertex_t, switch_t>> postponed_t;
 
+    /* v only ever ors into its own end of an edge, out_bits[2 * e] if it is
+     * the tail of e and out_bits[2 * e + 1] if it is the head; returns false
+     * if v has to be postponed */
+    auto assign_ports_around = [&](vertex_t v, switch_t switch_direction, postponed_t &postponed_vertices, port_assignment_t *out_bits, drawing_counts_t &counts) -> bool
+    {
         DEBUG_PRINT("considering vertex " << graph.labels[v]);
         size_t num_neighbors = graph.degree(v);
         bool *orientations = new bool[num_neighbors];
+        auto bits_at = [&](size_t edge_ix) -> port_assignment_t &
+        {
+            return out_bits[2 * graph.vertices[v][edge_ix] + !orientations[edge_ix]];
+        };
         /* find sections of edges that go through each side of the rectangle */
         size_t first_edge[] = { num_neighbors, num_neighbors, num_neighbors, num_neighbors };
         size_t num_edges_in_direction[] = { 0, 0, 0, 0 };
@@ -218,9 +204,8 @@ void port_assignment(const four_connected_component_t &graph, const rectangular_
                 for (size_t i = 0; i < num_edges_in_direction[current]; ++i)
                 {
                     const size_t edge_ix = (first_edge[current] + i) % num_neighbors;
-                    if (!(out_pa[graph.original_edge[graph.vertices[v][edge_ix]]] & 0b100))
-                        out_pa[graph.original_edge[graph.vertices[v][edge_ix]]]
-                            |= (canonical_assignment[current] ^ mono_directed_switch) & (orientations[edge_ix] ? 0b10 : 0b01);
+                    bits_at(edge_ix)
+                        |= (canonical_assignment[current] ^ mono_directed_switch) & (orientations[edge_ix] ? 0b10 : 0b01);
                 }
             }
             return true;
@@ -229,7 +214,11 @@ void port_assignment(const four_connected_component_t &graph, const rectangular_
                 || !assign_mono_directed_sides(direction_t::TOP)
                 || !assign_mono_directed_sides(direction_t::LEFT)
                 || !assign_mono_directed_sides(direction_t::BOTTOM))
-            continue; // skip v to come back later
+        {
+            delete[] orientations;
+            ++counts.postponed_vertices;
+            return false; // skip v to come back later
+        }
 
         /* port assingment for 3-directed sides */
         auto assign_3_directed_sides = [&](direction_t current, unsigned char pattern) -> void
@@ -244,9 +233,8 @@ void port_assignment(const four_connected_component_t &graph, const rectangular_
                     const size_t edge_ix = (first_edge[current] + i) % num_neighbors;
                     if (orientations[edge_ix] == bool(pattern & 0b010))
                         first_third = 0b00;
-                    if (!(out_pa[graph.original_edge[graph.vertices[v][edge_ix]]] & 0b100))
-                        out_pa[graph.original_edge[graph.vertices[v][edge_ix]]]
-                            |= (canonical_assignment[current] ^ first_third) & (orientations[edge_ix] ? 0b10 : 0b01);
+                    bits_at(edge_ix)
+                        |= (canonical_assignment[current] ^ first_third) & (orientations[edge_ix] ? 0b10 : 0b01);
                 }
             }
             else if (directions[current] == (pattern ^ 0b0111))
@@ -262,9 +250,8 @@ void port_assignment(const four_connected_component_t &graph, const rectangular_
                         last_third = 0b100;
                     else if (last_third)
                         last_third = 0b011;
-                    if (!(out_pa[graph.original_edge[graph.vertices[v][edge_ix]]] & 0b100))
-                        out_pa[graph.original_edge[graph.vertices[v][edge_ix]]]
-                            |= (canonical_assignment[current] ^ last_third) & (orientations[edge_ix] ? 0b10 : 0b01);
+                    bits_at(edge_ix)
+                        |= (canonical_assignment[current] ^ last_third) & (orientations[edge_ix] ? 0b10 : 0b01);
                 }
             }
         };
@@ -282,9 +269,8 @@ void port_assignment(const four_connected_component_t &graph, const rectangular_
                 for (size_t i = 0; i < num_edges_in_direction[current]; ++i)
                 {
                     const size_t edge_ix = (first_edge[current] + i) % num_neighbors;
-                    if (!(out_pa[graph.original_edge[graph.vertices[v][edge_ix]]] & 0b100))
-                        out_pa[graph.original_edge[graph.vertices[v][edge_ix]]]
-                            |= canonical_assignment[current] & (orientations[edge_ix] ? 0b10 : 0b01);
+                    bits_at(edge_ix)
+                        |= canonical_assignment[current] & (orientations[edge_ix] ? 0b10 : 0b01);
                 }
             }
         };
@@ -349,6 +335,7 @@ void port_assignment(const four_connected_component_t &graph, const rectangular_
                             {
                                 DEBUG_PRINT(graph.labels[v] << " is master of " << graph.labels[left_neighbor] << " and " << graph.labels[right_neighbor] << " in extra rule");
                                 v_is_master_in_extra_rule = true;
+                                ++counts.extra_rules;
                                 postponed_vertices.emplace_back(left_neighbor, switch_t::ANY);
                                 postponed_vertices.emplace_back(right_neighbor, switch_t::ANY);
                             }
@@ -373,9 +360,8 @@ lbl_counter_clockwise:
                         const size_t edge_ix = (first_edge[current] + i) % num_neighbors;
                         if (orientations[edge_ix] == bool(directions[current] & 0b001))
                             last_half = 0b11;
-                        if (!(out_pa[graph.original_edge[graph.vertices[v][edge_ix]]] & 0b100))
-                            out_pa[graph.original_edge[graph.vertices[v][edge_ix]]]
-                                |= (canonical_assignment[current] ^ last_half) & (orientations[edge_ix] ? 0b10 : 0b01);
+                        bits_at(edge_ix)
+                            |= (canonical_assignment[current] ^ last_half) & (orientations[edge_ix] ? 0b10 : 0b01);
                     }
                 }
                 else
@@ -394,9 +380,8 @@ lbl_clockwise:
                         const size_t edge_ix = (first_edge[current] + i) % num_neighbors;
                         if (orientations[edge_ix] == bool(directions[current] & 0b001))
                             first_half = 0b00;
-                        if (!(out_pa[graph.original_edge[graph.vertices[v][edge_ix]]] & 0b100))
-                            out_pa[graph.original_edge[graph.vertices[v][edge_ix]]]
-                                |= (canonical_assignment[current] ^ first_half) & (orientations[edge_ix] ? 0b10 : 0b01);
+                        bits_at(edge_ix)
+                            |= (canonical_assignment[current] ^ first_half) & (orientations[edge_ix] ? 0b10 : 0b01);
                     }
                 }
             }
@@ -407,8 +392,72 @@ lbl_clockwise:
         assign_unpleasant_switches(direction_t::BOTTOM, 0b110);
 
         delete[] orientations;
+        return true;
+    };
+
+    /* handles the vertices postponed by a master in the extra rule in the
+     * same order as if they had been handled right after it */
+    auto assign_ports_of_postponed = [&](postponed_t &postponed_vertices, port_assignment_t *out_bits) -> void
+    {
+        while (!postponed_vertices.empty())
+        {
+            const auto [v, switch_direction] = postponed_vertices.back();
+            postponed_vertices.pop_back();
+            assign_ports_around(v, switch_direction, postponed_vertices, out_bits, out_counts);
+        }
+    };
+
+    port_assignment_t *bits = new port_assignment_t[2 * graph.num_edges()];
+    for (size_t i = 0; i < 2 * graph.num_edges(); ++i)
+        bits[i] = 0b00;
+
+    if (num_threads > 1 && graph.num_vertices() >= parallel_threshold * num_threads)
+    {
+        /* every vertex in its own range is handled concurrently; whatever it
+         * postpones may belong to another range, so it is handled afterwards */
+        std::vector<std::vector<postponed_t>> deferred(num_threads);
+        std::vector<drawing_counts_t> counts(num_threads, drawing_counts_t{});
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t < num_threads; ++t)
+            threads.emplace_back([&, t]()
+            {
+                timer::scope phase("pa/port_assignment/range");
+                const vertex_t first = graph.num_vertices() * t / num_threads;
+                const vertex_t last = graph.num_vertices() * (t + 1) / num_threads;
+                postponed_t postponed_vertices;
+                for (vertex_t v = first; v < last; ++v)
+                {
+                    assign_ports_around(v, switch_t::ANY, postponed_vertices, bits, counts[t]);
+                    if (!postponed_vertices.empty())
+                    {
+                        deferred[t].push_back(postponed_vertices);
+                        postponed_vertices.clear();
+                    }
+                }
+            });
+        for (auto &thread : threads)
+            thread.join();
+        for (const drawing_counts_t &counts_of_thread : counts)
+            out_counts += counts_of_thread;
+        for (auto &postponed_of_thread : deferred)
+            for (auto &postponed_vertices : postponed_of_thread)
+                assign_ports_of_postponed(postponed_vertices, bits);
+    }
+    else
+    {
+        postponed_t postponed_vertices;
+        for (vertex_t v = 0; v < graph.num_vertices(); ++v)
+        {
+            assign_ports_around(v, switch_t::ANY, postponed_vertices, bits, out_counts);
+            assign_ports_of_postponed(postponed_vertices, bits);
+        }
     }
 
+    for (size_t edge_ix = 0; edge_ix < graph.num_edges(); ++edge_ix)
+        if (!(out_pa[graph.original_edge[edge_ix]] & 0b100))
+            out_pa[graph.original_edge[edge_ix]] |= bits[2 * edge_ix] | bits[2 * edge_ix + 1];
+    delete[] bits;
+
     for (size_t edge_ix = 0; edge_ix < graph.num_edges(); ++edge_ix)
     {
         out_pa[graph.original_edge[edge_ix]] |= 0b100;
@@ -418,56 +467,177 @@ lbl_clockwise:
     }
 }
 
-void toposort(const graph_t &graph, coord_t *out_order)
+/* Orders the vertices topologically in both dags induced by the port
+ * assignment: in the x dag every edge points the way its horizontal segment is
+ * drawn, in the y dag the way its vertical segment is drawn.  Both dags are
+ * stored as adjacency arrays that are filled by walking over the edges, so no
+ * intermediate graph is built.  With more than one thread the two dags are
+ * sorted concurrently.  By default the vertices are numbered exactly as by the
+ * sequential algorithm; level_order numbers them level by level instead, which
+ * lets large levels be processed in parallel. */
+status_t toposort_dags(const graph_t &graph, const port_assignment_t *pa, coord_t *out_x, coord_t *out_y,
+    unsigned num_threads, bool level_order, drawing_buffers_t &buffers)
 {
-    std::vector<vertex_t> sources;
-    size_t *indeg = new size_t[graph.num_vertices()];
-    for (vertex_t v = 0; v < graph.num_vertices(); ++v)
+    const size_t n = graph.num_vertices();
+    const size_t m = graph.num_edges();
+
+    /* axis 0 is x, axis 1 is y */
+    size_t *indeg[2], *first_out[2], *next_out[2];
+    vertex_t *out_neighbor[2];
+    for (int axis = 0; axis < 2; ++axis)
     {
-        indeg[v] = 0;
-        for (size_t edge_ix : graph.vertices[v])
-            if (v == graph.edges[edge_ix].head)
-                ++indeg[v];
-        if (indeg[v] == 0)
-            sources.push_back(v);
+        buffers.indeg[axis].assign(n, 0);
+        buffers.first_out[axis].assign(n + 1, 0);
+        buffers.next_out[axis].resize(n);
+        buffers.out_neighbor[axis].resize(m);
+        indeg[axis] = buffers.indeg[axis].data();
+        first_out[axis] = buffers.first_out[axis].data();
+        next_out[axis] = buffers.next_out[axis].data();
+        out_neighbor[axis] = buffers.out_neighbor[axis].data();
     }
-    coord_t next_order = 0;
-    while (!sources.empty())
+
+    auto source_of = [&](size_t i, int axis) -> vertex_t
     {
-        vertex_t v = sources.back();
-        sources.pop_back();
-        out_order[v] = next_order++;
-        for (size_t edge_ix : graph.vertices[v])
-            if (v == graph.edges[edge_ix].tail && indeg[graph.edges[edge_ix].head] != 0) // not already visited
-                if (--indeg[graph.edges[edge_ix].head] == 0)
-                    sources.push_back(graph.edges[edge_ix].head);
-    }
-    if (next_order != graph.num_vertices())
+        return pa[i] & (1 << axis) ? graph.edges[i].tail : graph.edges[i].head;
+    };
+    auto target_of = [&](size_t i, int axis) -> vertex_t
     {
-        std::cerr << "Cycle detected during topological sorting. Exiting." << std::endl;
-        exit(1);
-    }
-    delete[] indeg;
-}
+        return pa[i] & (1 << axis) ? graph.edges[i].head : graph.edges[i].tail;
+    };
 
-void construct_dag(const graph_t &graph, const port_assignment_t *pa, bool y_coords, graph_t &out_dag)
-{
-    const char mask = y_coords ? 0b10 : 0b01;
-    out_dag.vertices.resize(graph.num_vertices());
-    out_dag.edges.reserve(graph.num_edges());
-    for (size_t i = 0; i < graph.num_edges(); ++i)
+    for (size_t i = 0; i < m; ++i)
+        for (int axis = 0; axis < 2; ++axis)
+        {
+            ++first_out[axis][source_of(i, axis) + 1];
+            ++indeg[axis][target_of(i, axis)];
+        }
+    for (int axis = 0; axis < 2; ++axis)
+        for (vertex_t v = 0; v < n; ++v)
+            first_out[axis][v + 1] += first_out[axis][v];
+    /* out-neighbors end up in order of edge index */
+    for (int axis = 0; axis < 2; ++axis)
+        std::copy(first_out[axis], first_out[axis] + n, next_out[axis]);
+    for (size_t i = 0; i < m; ++i)
+        for (int axis = 0; axis < 2; ++axis)
+            out_neighbor[axis][next_out[axis][source_of(i, axis)]++] = target_of(i, axis);
+
+    /* Kahn's algorithm taking sources LIFO, i.e. the order of the original
+     * single-threaded implementation */
+    auto sort_stack = [&](int axis, coord_t *out_order) -> bool
+    {
+        std::vector<vertex_t> sources;
+        for (vertex_t v = 0; v < n; ++v)
+            if (indeg[axis][v] == 0)
+                sources.push_back(v);
+        coord_t next_order = 0;
+        while (!sources.empty())
+        {
+            vertex_t v = sources.back();
+            sources.pop_back();
+            out_order[v] = next_order++;
+            for (size_t j = first_out[axis][v]; j < first_out[axis][v + 1]; ++j)
+            {
+                const vertex_t w = out_neighbor[axis][j];
+                if (indeg[axis][w] != 0) // not already visited
+                    if (--indeg[axis][w] == 0)
+                        sources.push_back(w);
+            }
+        }
+        return next_order == n;
+    };
+
+    /* Kahn's algorithm processing one level of sources at a time.  Large
+     * levels are split among the workers.  Each level is numbered in order of
+     * vertex id, so the result does not depend on the number of workers. */
+    auto sort_levels = [&](int axis, coord_t *out_order, unsigned workers) -> bool
+    {
+        std::atomic<size_t> *remaining = new std::atomic<size_t>[n];
+        std::vector<vertex_t> level, next_level;
+        for (vertex_t v = 0; v < n; ++v)
+        {
+            remaining[v].store(indeg[axis][v], std::memory_order_relaxed);
+            if (indeg[axis][v] == 0)
+                level.push_back(v);
+        }
+
+        auto relax = [&](size_t begin, size_t end, std::vector<vertex_t> &out_sources)
+        {
+            for (size_t k = begin; k < end; ++k)
+                for (size_t j = first_out[axis][level[k]]; j < first_out[axis][level[k] + 1]; ++j)
+                {
+                    const vertex_t w = out_neighbor[axis][j];
+                    if (remaining[w].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                        out_sources.push_back(w);
+                }
+        };
+
+        coord_t next_order = 0;
+        std::vector<std::vector<vertex_t>> found(workers);
+        while (!level.empty())
+        {
+            for (size_t k = 0; k < level.size(); ++k)
+                out_order[level[k]] = next_order + k;
+            next_order += level.size();
+
+            next_level.clear();
+            if (workers > 1 && level.size() >= parallel_threshold * workers)
+            {
+                std::vector<std::thread> threads;
+                for (unsigned t = 0; t < workers; ++t)
+                {
+                    found[t].clear();
+                    threads.emplace_back(relax,
+                        level.size() * t / workers, level.size() * (t + 1) / workers,
+                        std::ref(found[t]));
+                }
+                for (unsigned t = 0; t < workers; ++t)
+                {
+                    threads[t].join();
+                    next_level.insert(next_level.end(), found[t].begin(), found[t].end());
+                }
+            }
+            else
+                relax(0, level.size(), next_level);
+            std::sort(next_level.begin(), next_level.end());
+            level.swap(next_level);
+        }
+        delete[] remaining;
+        return next_order == n;
+    };
+
+    auto sort_axis = [&](int axis, coord_t *out_order, unsigned workers) -> bool
     {
-        const edge_t &e = graph.edges[i];
-        if (pa[i] & mask)
-            out_dag.edges.push_back(e);
+        if (level_order)
+            return sort_levels(axis, out_order, workers);
         else
-            out_dag.edges.push_back({ e.head, e.tail });
-        out_dag.vertices[e.tail].push_back(i);
-        out_dag.vertices[e.head].push_back(i);
+            return sort_stack(axis, out_order);
+    };
+
+    bool acyclic[2];
+    if (num_threads > 1)
+    {
+        /* the two dags are independent */
+        const unsigned workers = std::max(num_threads / 2, 1u);
+        std::thread y_thread([&]()
+        {
+            timer::scope phase("pa/toposort/y");
+            acyclic[1] = sort_axis(1, out_y, workers);
+        });
+        acyclic[0] = sort_axis(0, out_x, std::max(num_threads - workers, 1u));
+        y_thread.join();
+    }
+    else
+    {
+        acyclic[0] = sort_axis(0, out_x, 1);
+        acyclic[1] = sort_axis(1, out_y, 1);
     }
+
+    if (!acyclic[0] || !acyclic[1])
+        return fail(status_t::NOT_DRAWABLE, "Cycle detected during topological sorting");
+    return status_t::OK;
 }
 
-outer_face_t add_x(four_connected_component_t &graph, const port_assignment_t *pa, size_t dummy_edge)
+status_t add_x(four_connected_component_t &graph, const port_assignment_t *pa, size_t dummy_edge, outer_face_t &out_drawing_of_outer_face)
 {
     const vertex_t a = graph.outer_face[0];
     const vertex_t b = graph.outer_face[1];
@@ -689,10 +859,7 @@ outer_face_t add_x(four_connected_component_t &graph, const port_assignment_t *p
             }
         }
         else
-        {
-            std::cerr << "Unrecognized drawing of outer face. Exiting." << std::endl;
-            exit(1);
-        }
+            return fail(status_t::NOT_DRAWABLE, "Unrecognized drawing of outer face");
     }
 
     DEBUG_PRINT("inserting dummy into edge " << graph.labels[graph.edges[target_edge].tail]
@@ -774,7 +941,8 @@ outer_face_t add_x(four_connected_component_t &graph, const port_assignment_t *p
             break;
     }
 
-    return ret;
+    out_drawing_of_outer_face = ret;
+    return status_t::OK;
 }
 
 /* change the corners of the dual */
@@ -996,7 +1164,11 @@ void port_assignment_of_outer_face(const four_connected_component_t &graph, port
 
 void add_virtual_edges(four_connected_component_t &graph, rectangular_dual_t &dual, size_t dummy_edge)
 {
-    for (vertex_t v = 0; v < graph.num_vertices(); ++v)
+    /* add all virtual vertices and edges first, and only then insert the
+     * virtual edges into the rotation systems, with one pass per vertex */
+    const size_t num_vertices = graph.num_vertices();
+    std::vector<std::pair<vertex_t, size_t>> virtual_edges; // (v, virtual edge)
+    for (vertex_t v = 0; v < num_vertices; ++v)
         if (graph.designated_face[v])
         {
             const size_t virtual_vertex = graph.num_vertices();
@@ -1083,34 +1255,56 @@ void add_virtual_edges(four_connected_component_t &graph, rectangular_dual_t &du
             const bool outgoing = v == graph.edges[graph.vertices[v][face]].head;
             if (face == 0)
                 face = graph.degree(v); // equivalent, but easier to insert
-            graph.vertices[v].insert(graph.vertices[v].begin() + face, virtual_edge);
             if (outgoing)
-            {
                 graph.edges.push_back({ v, virtual_vertex, face, 0 });
-                for (size_t i = face; i < graph.degree(v); ++i)
-                    ++graph.edges[graph.vertices[v][i]].index_at_head;
-            }
             else
-            {
                 graph.edges.push_back({ virtual_vertex, v, 0, face });
-                for (size_t i = face; i < graph.degree(v); ++i)
-                    ++graph.edges[graph.vertices[v][i]].index_at_tail;
-            }
+            virtual_edges.emplace_back(v, virtual_edge);
         }
+
+    std::vector<size_t> rotation;
+    for (const auto &[v, virtual_edge] : virtual_edges)
+    {
+        const size_t face = graph.neighbor_index(v, virtual_edge);
+        rotation.clear();
+        rotation.reserve(graph.degree(v) + 1);
+        rotation.insert(rotation.end(), graph.vertices[v].begin(), graph.vertices[v].begin() + face);
+        rotation.push_back(virtual_edge);
+        for (size_t i = face; i < graph.degree(v); ++i)
+        {
+            const size_t e = graph.vertices[v][i];
+            if (v == graph.edges[e].tail)
+                graph.edges[e].index_at_tail = rotation.size();
+            else
+                graph.edges[e].index_at_head = rotation.size();
+            rotation.push_back(e);
+        }
+        graph.vertices[v].swap(rotation);
+    }
 }
 
-l_drawing_t construct_drawing(const graph_t &graph, four_block_tree_t &four_block_tree, bool print_duals)
+status_t construct_drawing(const graph_t &graph, four_block_tree_t &four_block_tree, l_drawing_t &out_drawing, drawing_counts_t &out_counts,
+    drawing_buffers_t &buffers, std::ostream *duals_os, unsigned num_threads, bool level_order)
 {
-    timer::start(timer::PORT_ASSIGNMENT);
+    out_counts = {};
+    timer::scope phase("pa", timer::PORT_ASSIGNMENT);
 
-    port_assignment_t *pa = new port_assignment_t[graph.num_edges() + 1];
-    for (size_t i = 0; i < graph.num_edges() + 1; ++i)
-        pa[i] = 0b00;
+    buffers.pa.assign(graph.num_edges() + 1, 0b00);
+    port_assignment_t *pa = buffers.pa.data();
+    rectangular_dual_t &rect_dual = buffers.rect_dual;
 
     port_assignment_of_outer_face(four_block_tree.front(), pa);
+    status_t status = status_t::OK;
     for (auto &component : four_block_tree)
     {
-        outer_face_t of = add_x(component, pa, graph.num_edges());
+        outer_face_t of;
+        {
+            timer::scope phase("add_x");
+            status = add_x(component, pa, graph.num_edges(), of);
+        }
+        if (status != status_t::OK)
+            break;
+        ++out_counts.outer_face[size_t(of)];
 
 #ifdef DEBUG
         DEBUG_PRINT("after adding x:");
@@ -1129,29 +1323,39 @@ l_drawing_t construct_drawing(const graph_t &graph, four_block_tree_t &four_bloc
         }
 #endif // DEBUG
 
-        timer::stop(timer::PORT_ASSIGNMENT);
-
-        timer::start(timer::RECT_DUAL);
-        rectangular_dual_t rect_dual = compute_rect_dual(component);
-        timer::stop(timer::RECT_DUAL);
-
-        timer::start(timer::PORT_ASSIGNMENT);
+        {
+            timer::scope phase("rect_dual", timer::RECT_DUAL);
+            status = compute_rect_dual(component, rect_dual);
+        }
+        if (status != status_t::OK)
+            break;
 
-        fix_rectangular_dual(component, rect_dual, of);
+        {
+            timer::scope phase("fix_rect_dual");
+            fix_rectangular_dual(component, rect_dual, of);
+        }
 
-        if (print_duals)
+        if (duals_os != nullptr)
         {
-            timer::stop(timer::PORT_ASSIGNMENT);
-            timer::start(timer::IO);
-            write_tikz(std::cout, component, rect_dual);
-            timer::stop(timer::IO);
-            timer::start(timer::PORT_ASSIGNMENT);
+            timer::scope phase("print_duals", timer::IO);
+            write_tikz(*duals_os, component, rect_dual);
         }
 
-        add_virtual_edges(component, rect_dual, graph.num_edges());
-        port_assignment(component, rect_dual, pa);
+        {
+            timer::scope phase("virtual_edges");
+            const size_t num_vertices = component.num_vertices();
+            add_virtual_edges(component, rect_dual, graph.num_edges());
+            out_counts.virtual_vertices += component.num_vertices() - num_vertices;
+        }
+        {
+            timer::scope phase("port_assignment");
+            port_assignment(component, rect_dual, pa, num_threads, out_counts);
+        }
     }
 
+    if (status != status_t::OK)
+        return status;
+
 #ifdef DEBUG
     for (size_t i = 0; i < graph.num_edges(); ++i)
         if (!bool(pa[i] & 0b100))
@@ -1161,23 +1365,76 @@ l_drawing_t construct_drawing(const graph_t &graph, four_block_tree_t &four_bloc
         }
 #endif // DEBUG
 
-    graph_t x_dag, y_dag;
-    construct_dag(graph, pa, false, x_dag);
-    construct_dag(graph, pa, true,  y_dag);
-    delete[] pa;
-
-    coord_t *x_coords = new coord_t[graph.num_vertices()];
-    coord_t *y_coords = new coord_t[graph.num_vertices()];
-    toposort(x_dag, x_coords);
-    toposort(y_dag, y_coords);
+    buffers.x_coords.resize(graph.num_vertices());
+    buffers.y_coords.resize(graph.num_vertices());
+    coord_t *x_coords = buffers.x_coords.data(), *y_coords = buffers.y_coords.data();
+    {
+        timer::scope phase("toposort");
+        status = toposort_dags(graph, pa, x_coords, y_coords, num_threads, level_order, buffers);
+    }
 
-    l_drawing_t out_drawing;
+    out_drawing.resize(graph.num_vertices());
     for (vertex_t v = 0; v < graph.num_vertices(); ++v)
-        out_drawing.push_back({ x_coords[v], y_coords[v] });
-    delete[] x_coords;
-    delete[] y_coords;
+        out_drawing[v] = { x_coords[v], y_coords[v] };
+
+    return status;
+}
+
+/* Merges consecutive columns and then consecutive rows of the drawing as long
+ * as no two vertices in a column (row) have overlapping vertical (horizontal)
+ * extents, i.e. the vertex itself together with its outgoing vertical
+ * (incoming horizontal) segments.  Since the order of the columns and rows is
+ * kept, this neither creates crossings nor lets edges touch.  Expects every
+ * vertex to have its own x and y coordinate, as computed by construct_drawing.
+ */
+void compact_drawing(const graph_t &graph, l_drawing_t &drawing)
+{
+    const size_t n = graph.num_vertices();
+    vertex_t *by_coord = new vertex_t[n];
+    coord_t *extent_min = new coord_t[n];
+    coord_t *extent_max = new coord_t[n];
+    std::set<std::pair<coord_t,coord_t>> current_line;
+
+    auto compact = [&](coord_t position_t::*along, coord_t position_t::*across, bool outgoing)
+    {
+        for (vertex_t v = 0; v < n; ++v)
+        {
+            by_coord[drawing[v].*along] = v;
+            extent_min[v] = extent_max[v] = drawing[v].*across;
+        }
+        for (const edge_t &e : graph.edges)
+        {
+            const vertex_t v = outgoing ? e.tail : e.head;
+            const coord_t c = drawing[outgoing ? e.head : e.tail].*across;
+            extent_min[v] = std::min(extent_min[v], c);
+            extent_max[v] = std::max(extent_max[v], c);
+        }
+
+        coord_t line = 0;
+        current_line.clear();
+        for (size_t i = 0; i < n; ++i)
+        {
+            const vertex_t v = by_coord[i];
+            const std::pair<coord_t,coord_t> extent(extent_min[v], extent_max[v]);
+            /* the extents in current_line are disjoint, so only the neighbors
+             * of the new one need to be checked */
+            auto next = current_line.lower_bound(extent);
+            const bool overlaps = (next != current_line.end() && next->first <= extent.second)
+                || (next != current_line.begin() && std::prev(next)->second >= extent.first);
+            if (overlaps)
+            {
+                ++line;
+                current_line.clear();
+            }
+            current_line.insert(extent);
+            drawing[v].*along = line;
+        }
+    };
 
-    timer::stop(timer::PORT_ASSIGNMENT);
+    compact(&position_t::x, &position_t::y, true);
+    compact(&position_t::y, &position_t::x, false);
 
-    return out_drawing;
+    delete[] by_coord;
+    delete[] extent_min;
+    delete[] extent_max;
 }
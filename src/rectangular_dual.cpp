@@ -21,7 +21,7 @@ T succ(T it)
     return ++it;
 }
 
-void compute_ordering31(const graph_t &graph, ordering31_t &out_ordering)
+status_t compute_ordering31(const graph_t &graph, ordering31_t &out_ordering)
 {
     std::vector<vertex_t> leg_free, basic_two_leg_centers;
     std::vector<std::vector<vertex_t>> outer(graph.num_vertices());
@@ -35,6 +35,7 @@ void compute_ordering31(const graph_t &graph, ordering31_t &out_ordering)
     auto *picked                   = new bool[graph.num_vertices()];
     auto *was_two_leg_center       = new bool[graph.num_vertices()];
     size_t num_not_picked = graph.num_vertices();
+    status_t status = status_t::OK;
     for (vertex_t v = 0; v < graph.num_vertices(); ++v)
     {
         position_in_boundary[v] = boundary.end();
@@ -263,7 +264,11 @@ void compute_ordering31(const graph_t &graph, ordering31_t &out_ordering)
             out_ordering.back().predecessors.push_back(vr);
         }
         else
-            exit(1);
+        {
+            /* there is no next path */
+            status = fail(status_t::NOT_DRAWABLE, "Graph has no canonical ordering for a rectangular dual");
+            break;
+        }
 
 #ifdef DEBUG
         DEBUG_PRINT("contents:");
@@ -305,7 +310,7 @@ void compute_ordering31(const graph_t &graph, ordering31_t &out_ordering)
     delete[] was_two_leg_center;
 
     std::reverse(out_ordering.begin(), out_ordering.end());
-    return;
+    return status;
 
     out_ordering.clear();
     const vertex_t s = 0, t = 1, u = 2, v = 3, w = 4, x = 5, y = 6, z = 7;
@@ -315,12 +320,14 @@ void compute_ordering31(const graph_t &graph, ordering31_t &out_ordering)
     out_ordering.push_back({ { s }, { x, y, u, t } });
 }
 
-rectangular_dual_t compute_rect_dual(const graph_t &graph)
+status_t compute_rect_dual(const graph_t &graph, rectangular_dual_t &out_rect_dual)
 {
     ordering31_t ordering;
-    compute_ordering31(graph, ordering);
+    status_t status = compute_ordering31(graph, ordering);
+    if (status != status_t::OK)
+        return status;
 
-    rectangular_dual_t out_rect_dual(graph.num_vertices());
+    out_rect_dual.assign(graph.num_vertices(), {});
     coord_t top = 0;
     std::list<coord_t> vertical;
     auto *x_min = new std::list<coord_t>::iterator[graph.num_vertices()];
@@ -362,7 +369,11 @@ rectangular_dual_t compute_rect_dual(const graph_t &graph)
         {
             auto it = x_max[path.predecessors.front()];
             size_t i;
-            if (path.contents.empty()) exit(1); // TODO
+            if (path.contents.empty())
+            {
+                status = fail(status_t::NOT_DRAWABLE, "Graph has no canonical ordering for a rectangular dual");
+                break;
+            }
             for (i = 0; i < path.contents.size() - 1; ++i)
             {
                 vertex_t v = path.contents[i];
@@ -388,13 +399,14 @@ rectangular_dual_t compute_rect_dual(const graph_t &graph)
     coord_t x = 0;
     for (coord_t &vert : vertical)
         vert = x++;
-    for (size_t i = 0; i < out_rect_dual.size(); ++i)
-    {
-        out_rect_dual[i].x_min = *x_min[i];
-        out_rect_dual[i].x_max = *x_max[i];
-    }
+    if (status == status_t::OK)
+        for (size_t i = 0; i < out_rect_dual.size(); ++i)
+        {
+            out_rect_dual[i].x_min = *x_min[i];
+            out_rect_dual[i].x_max = *x_max[i];
+        }
     delete[] x_min;
     delete[] x_max;
 
-    return out_rect_dual;
+    return status;
 }
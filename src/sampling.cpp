@@ -0,0 +1,508 @@
+#include <algorithm>
+#include <vector>
+#include <random>
+#include <functional>
+#include <iostream>
+#include "include/sampling.hpp"
+#include "include/io.hpp"
+
+std::vector<bool> random_bitstring(size_t length, size_t weight, std::mt19937 &gen)
+{
+    size_t buckets = weight + 1;
+    size_t items = length - weight;
+    std::vector<size_t> num_zeros_after_one(buckets);
+
+    auto random_double = std::bind(std::generate_canonical<double, std::numeric_limits<double>::digits, std::mt19937>, gen);
+    while (items > 0)
+    {
+        if (random_double() < double(items) / double(buckets + items - 1))
+        {
+            ++num_zeros_after_one[buckets - 1];
+            --items;
+        }
+        else
+            --buckets;
+    }
+
+    /* only the ones need to be set in the packed words of the bitstring */
+    std::vector<bool> bitstring(length, false);
+    size_t position = 0;
+    for (size_t i = 0; i + 1 < num_zeros_after_one.size(); ++i)
+    {
+        position += num_zeros_after_one[i];
+        bitstring[position++] = true;
+    }
+
+    return bitstring;
+}
+
+std::vector<bool> find_permutation(const std::vector<bool> &in)
+{
+    int ones3_zeros = 0, value_of_minimum = 3 * in.size();
+    size_t index_of_minimum = 0;
+    for (size_t i = 0; i < in.size(); ++i)
+    {
+        ones3_zeros += in[i] ? 3 : -1;
+        if (ones3_zeros < value_of_minimum)
+        {
+            value_of_minimum = ones3_zeros;
+            index_of_minimum = i;
+        }
+    }
+
+    std::vector<bool> out;
+    out.reserve(in.size());
+    out.insert(out.end(), in.begin() + index_of_minimum + 1, in.end());
+    out.insert(out.end(), in.begin(), in.begin() + index_of_minimum + 1);
+    return out;
+}
+
+sample_graph_t code_to_tree(const std::vector<bool> &bitstring)
+{
+    const size_t leaf = bitstring.size() / 4 + 1;
+    std::vector<size_t> stack;
+    std::vector<unsigned char> num_leaves;
+    sample_graph_t graph;
+
+    /* add initial vertex */
+    stack.push_back(0);
+    num_leaves.push_back(0);
+    graph.add_vertex();
+
+    for (auto b : bitstring)
+    {
+        if (b)
+        {
+            /* add inner vertex */
+            size_t old_top = stack.back();
+            size_t new_top = graph.add_vertex();
+            size_t new_edge = graph.add_edge(old_top, new_top);
+            graph.push_back(old_top, graph.edges[new_edge].tail_it);
+            graph.push_back(new_top, graph.edges[new_edge].head_it);
+
+            num_leaves.push_back(0);
+            stack.push_back(new_top);
+        }
+        else
+        {
+            size_t top = stack.back();
+            if (num_leaves[top] < 2)
+            {
+                /* add leaf, whose edge has only one end in a rotation */
+                size_t new_edge = graph.add_edge(top, leaf);
+                auto &e = graph.edges[new_edge];
+                e.head_it = e.tail_it;
+                graph.push_back(top, e.tail_it);
+
+                ++num_leaves[top];
+            }
+            else
+            {
+                /* go up */
+                stack.pop_back();
+            }
+        }
+    }
+
+    return graph;
+}
+
+/* outer face will be (return_value,graph.size()-2,graph.size()-1) */
+size_t complete_closure(sample_graph_t &graph)
+{
+    const size_t leaf = graph.num_vertices();
+
+    /* an edge traversed in one direction, stored as 2 * edge + reversed */
+    typedef sample_graph_t::node_t step_t;
+    auto edge_of = [&](step_t step) -> sample_graph_t::edge_t &
+    { return graph.edges[step / 2]; };
+    auto is_reversed = [](step_t step) -> bool { return step & 1; };
+    auto reverse = [](step_t step) -> step_t { return step ^ 1; };
+
+    std::vector<step_t> stack;
+    stack.reserve(12 * graph.num_vertices());
+    stack.push_back(2 * sample_graph_t::edge_of(graph.first.front()));
+
+    auto next_edge = [&](step_t step) -> step_t
+    {
+        const auto &edge = edge_of(step);
+        const bool reversed = is_reversed(step);
+        size_t old_head = reversed ? edge.tail : edge.head;
+        if (old_head == leaf)
+            return reverse(step);
+        else
+        {
+            auto it = graph.next[reversed ? edge.tail_it : edge.head_it];
+            size_t next_edge = sample_graph_t::edge_of(it);
+            bool next_reversed = old_head != graph.edges[next_edge].tail;
+            return 2 * next_edge + next_reversed;
+        }
+    };
+
+    auto is_leaf_edge = [&](step_t step)
+    { return edge_of(step).tail_it == edge_of(step).head_it; };
+
+    auto top_is_admissible_triangle = [&]()
+    {
+        return stack.size() >= 3
+            && !is_leaf_edge(stack[stack.size() - 3])
+            && !is_leaf_edge(stack[stack.size() - 2])
+            && is_leaf_edge(stack[stack.size() - 1]);
+    };
+
+    /* total number of edges is 3 * n, so in the end every edges is examined
+     * in both directions at least twice (twice around the graph) */
+    while (stack.size() < 12 * graph.num_vertices())
+    {
+        stack.push_back(next_edge(stack.back()));
+        while (top_is_admissible_triangle())
+        {
+            /* local closure */
+            const step_t e1 = stack[stack.size() - 3];
+            const step_t e3 = stack[stack.size() - 1];
+            auto e1_tail = is_reversed(e1) ? edge_of(e1).head : edge_of(e1).tail;
+            const auto e1_tail_it = is_reversed(e1) ? edge_of(e1).head_it : edge_of(e1).tail_it;
+            auto &e3_head = is_reversed(e3) ? edge_of(e3).tail : edge_of(e3).head;
+            auto &e3_head_it = is_reversed(e3) ? edge_of(e3).tail_it : edge_of(e3).head_it;
+            /* e3 is a leaf edge, its other end takes the unused node */
+            e3_head = e1_tail;
+            e3_head_it ^= 1;
+            graph.insert_before(e1_tail, e1_tail_it, e3_head_it);
+
+            stack.pop_back();
+            stack.pop_back();
+            stack.pop_back();
+            stack.push_back(reverse(e3));
+        }
+    }
+
+    /* find v0 */
+    auto edge_on_outer_face = stack.back();
+    std::vector<step_t>().swap(stack);
+    unsigned char consecutive_leaf_edges = 0;
+    while (consecutive_leaf_edges < 4)
+    {
+        edge_on_outer_face = next_edge(edge_on_outer_face);
+        if (is_leaf_edge(edge_on_outer_face))
+            ++consecutive_leaf_edges;
+        else
+            consecutive_leaf_edges = 0;
+    }
+    const size_t l1 = edge_on_outer_face / 2;
+    auto v0 = graph.edges[l1].tail;
+
+    size_t v1 = graph.add_vertex();
+    size_t v2 = graph.add_vertex();
+
+    while (true)
+    {
+        edge_of(edge_on_outer_face).head = v1;
+        edge_of(edge_on_outer_face).head_it ^= 1;
+        graph.push_front(v1, edge_of(edge_on_outer_face).head_it);
+
+        /* reverse edge as if we just came from v1 */
+        edge_on_outer_face |= 1;
+        edge_on_outer_face = next_edge(edge_on_outer_face);
+        if (is_leaf_edge(edge_on_outer_face))
+            break;
+        edge_on_outer_face = next_edge(edge_on_outer_face);
+    }
+    while (true)
+    {
+        edge_of(edge_on_outer_face).head = v2;
+        edge_of(edge_on_outer_face).head_it ^= 1;
+        graph.push_front(v2, edge_of(edge_on_outer_face).head_it);
+
+        /* reverse edge as if we just came from v2 */
+        edge_on_outer_face |= 1;
+        edge_on_outer_face = next_edge(edge_on_outer_face);
+        if (edge_on_outer_face / 2 == l1)
+            break;
+        edge_on_outer_face = next_edge(edge_on_outer_face);
+    }
+
+    /* add edge (v1,v2) */
+    size_t e = graph.add_edge(v1, v2);
+    graph.push_front(v1, graph.edges[e].tail_it);
+    graph.push_front(v2, graph.edges[e].head_it);
+
+    return v0;
+}
+
+void make_bimodal(sample_graph_t &graph)
+{
+    const size_t s = graph.num_vertices() - 2;
+    std::vector<bool> visited(graph.num_vertices(), false);
+    std::vector<bool> traversed(graph.edges.size(), false);
+    std::vector<bool> oriented(graph.edges.size(), false);
+    std::vector<size_t> parent(graph.num_vertices());
+    std::vector<size_t> edge_to_parent(graph.num_vertices());
+    std::vector<size_t> active_child_edge(graph.num_vertices());
+    std::vector<std::vector<size_t>> postponed_back_edges(graph.edges.size());
+    std::vector<std::pair<size_t, sample_graph_t::node_t>> stack = { { s, graph.first[s] } };
+    visited[s] = true;
+    oriented.back() = true;
+
+    auto reverse_edge = [&](size_t edge_index)
+    {
+        auto &e = graph.edges[edge_index];
+        e = { e.head, e.tail, e.head_it, e.tail_it };
+    };
+
+    while (!stack.empty())
+    {
+        auto &[v_ref, it] = stack.back();
+        const size_t v = v_ref;
+        size_t e = sample_graph_t::edge_of(it);
+        it = graph.next[it];
+        if (it == graph.first[v])
+            stack.pop_back();
+        bool forward = v == graph.edges[e].tail;
+        size_t w = forward ? graph.edges[e].head : graph.edges[e].tail;
+        if (!visited[w])
+        {
+            /* tree edge */
+#ifdef DEBUG_PRINT
+            std::cerr << "tree edge " << e << std::endl;
+#endif // DEBUG_PRINT
+            parent[w] = v;
+            active_child_edge[v] = e;
+            edge_to_parent[w] = e;
+            visited[w] = true;
+            stack.emplace_back(w, graph.first[w]);
+        }
+        else if (!traversed[e])
+        {
+            /* back edge */
+#ifdef DEBUG_PRINT
+            std::cerr << "back edge " << e << std::endl;
+#endif // DEBUG_PRINT
+            if (!forward)
+                reverse_edge(e);
+            // v is in subtree rooted at x, x is child of w
+            size_t e_wx = active_child_edge[w];
+            postponed_back_edges[e_wx].push_back(e);
+            std::vector<size_t> tree_edges_with_postponed_back_edges;
+            if (oriented[e_wx])
+                tree_edges_with_postponed_back_edges.push_back(e_wx);
+            for (size_t i = 0; i < tree_edges_with_postponed_back_edges.size(); ++i)
+            {
+                const size_t e_wx = tree_edges_with_postponed_back_edges[i];
+                const size_t w = graph.edges[postponed_back_edges[e_wx].front()].head;
+                bool away_from_w = w == graph.edges[e_wx].tail;
+                for (size_t back_edge : postponed_back_edges[e_wx])
+                {
+                    if (away_from_w)
+                        reverse_edge(back_edge);
+                    oriented[back_edge] = true;
+                    size_t u = away_from_w ? graph.edges[back_edge].head : graph.edges[back_edge].tail;
+                    size_t parent_edge_of_u = edge_to_parent[u];
+                    while (!oriented[parent_edge_of_u])
+                    {
+                        if ((u == graph.edges[parent_edge_of_u].tail) ^ away_from_w)
+                            reverse_edge(parent_edge_of_u);
+                        oriented[parent_edge_of_u] = true;
+                        if (!postponed_back_edges[parent_edge_of_u].empty())
+                            tree_edges_with_postponed_back_edges.push_back(parent_edge_of_u);
+                        u = parent[u];
+                        parent_edge_of_u = edge_to_parent[u];
+                    }
+                }
+                postponed_back_edges[e_wx].clear();
+            }
+        }
+        traversed[e] = true;
+    }
+
+#ifdef DEBUG_PRINT
+    for (size_t v = 0; v < parent.size(); ++v)
+        std::cerr << "parent[" << v << "] = " << parent[v]
+            << ", edge_to_parent[" << v << "] = " << edge_to_parent[v] << std::endl;
+
+    for (bool o : oriented)
+        if (!o)
+            exit(1);
+#endif // DEBUG_PRINT
+}
+
+void insert_2_cycles(sample_graph_t &graph, std::mt19937 &gen)
+{
+    /* find 0-modal vertices */
+    std::vector<bool> has_outgoing(graph.num_vertices(), false);
+    std::vector<bool> has_incoming(graph.num_vertices(), false);
+    for (const auto &e : graph.edges)
+    {
+        has_outgoing[e.tail] = true;
+        has_incoming[e.head] = true;
+    }
+    std::vector<bool> is_0_modal;
+    is_0_modal.reserve(graph.num_vertices());
+    for (size_t v = 0; v < graph.num_vertices(); ++v)
+        is_0_modal.push_back(!has_incoming[v] || !has_outgoing[v]);
+
+    /* duplicate edges where possible */
+    auto random_double = std::bind(std::generate_canonical<double, std::numeric_limits<double>::digits, std::mt19937>, gen);
+    auto random_bool = [&]() -> bool { return random_double() < .5; };
+
+    size_t num_edges = graph.edges.size();
+    for (size_t i = 0; i < num_edges; ++i)
+    {
+        const auto e = graph.edges[i];
+        const bool left = false; // right = true
+        auto try_adding = [&](bool side) -> bool
+        {
+            if (!is_0_modal[e.tail])
+            {
+                auto tail_it = side == left ? graph.next[e.tail_it] : graph.prev[e.tail_it];
+                if (e.tail == graph.edges[sample_graph_t::edge_of(tail_it)].tail) // next edge is also outgoing
+                    return false;
+            }
+            if (!is_0_modal[e.head])
+            {
+                auto head_it = side == left ? graph.prev[e.head_it] : graph.next[e.head_it];
+                if (e.head == graph.edges[sample_graph_t::edge_of(head_it)].head) // next edge is also incoming
+                    return false;
+            }
+
+            // If this point is reached, the edge can be inserted.
+            is_0_modal[e.tail] = is_0_modal[e.head] = false;
+            const auto &new_edge = graph.edges[graph.add_edge(e.head, e.tail)];
+            if (side == left)
+            {
+                graph.insert_after(e.tail_it, new_edge.head_it);
+                graph.insert_before(e.head, e.head_it, new_edge.tail_it);
+            }
+            else
+            {
+                graph.insert_before(e.tail, e.tail_it, new_edge.head_it);
+                graph.insert_after(e.head_it, new_edge.tail_it);
+            }
+
+#ifdef DEBUG_PRINT
+            std::cerr << "added 2-cycle to " << (side ? "right" : "left") << " side of edge " << e.tail+1 << '-' << e.head+1 << std::endl;
+#endif // DEBUG_PRINT
+
+            return true;
+        };
+        bool side = random_bool();
+        if (!try_adding(side))
+            try_adding(!side);
+    }
+}
+
+void print_graph(std::ostream &os, const sample_graph_t &graph, size_t v0)
+{
+    buffered_writer out(os);
+    out.put_uint(graph.num_vertices());
+    out.put(' ');
+    out.put_uint(graph.edges.size());
+    out.put(" 3\n");
+    out.put_uint(v0+1);
+    out.put(' ');
+    out.put_uint(graph.num_vertices()-1);
+    out.put(' ');
+    out.put_uint(graph.num_vertices());
+    out.put('\n');
+    for (size_t v = 0; v < graph.num_vertices(); ++v)
+    {
+        out.put_uint(v+1);
+        out.put('\n');
+    }
+    for (size_t i = 0; i < graph.edges.size(); ++i)
+    {
+        out.put_uint(graph.edges[i].tail+1);
+        out.put(' ');
+        out.put_uint(graph.edges[i].head+1);
+        out.put('\n');
+    }
+    for (size_t v = 0; v < graph.num_vertices(); ++v)
+    {
+        auto it = graph.first[v];
+        if (it != sample_graph_t::none)
+            do {
+                out.put_uint(sample_graph_t::edge_of(it)+1);
+                out.put(' ');
+                it = graph.next[it];
+            } while (it != graph.first[v]);
+        out.put('\n');
+    }
+}
+
+/* the same graph as print_graph, in the binary format of graph-format.md */
+void print_binary_graph(std::ostream &os, const sample_graph_t &graph, size_t v0)
+{
+    const size_t n = graph.num_vertices();
+    buffered_writer out(os);
+    out.put("LDGB");
+    out.put_u32(n);
+    out.put_u32(graph.edges.size());
+    out.put_u32(3);
+    out.put_u32(0);
+    out.put_u32(v0);
+    out.put_u32(n-2);
+    out.put_u32(n-1);
+    for (const auto &e : graph.edges)
+    {
+        out.put_u32(e.tail);
+        out.put_u32(e.head);
+    }
+    for (size_t v = 0; v < n; ++v)
+    {
+        uint32_t degree = 0;
+        auto it = graph.first[v];
+        if (it != sample_graph_t::none)
+            do {
+                ++degree;
+                it = graph.next[it];
+            } while (it != graph.first[v]);
+        out.put_u32(degree);
+        if (it != sample_graph_t::none)
+            do {
+                out.put_u32(sample_graph_t::edge_of(it));
+                it = graph.next[it];
+            } while (it != graph.first[v]);
+    }
+}
+
+/* the graph as read_graph would read it from the output of print_graph */
+graph_t to_graph(const sample_graph_t &graph, size_t v0)
+{
+    graph_t out_graph;
+    const size_t n = graph.num_vertices();
+    out_graph.vertices.reserve(n);
+    out_graph.labels.reserve(n);
+    out_graph.edges.reserve(graph.edges.size());
+    out_graph.outer_face = { v0, n - 2, n - 1 };
+    for (size_t v = 0; v < n; ++v)
+    {
+        out_graph.vertices.emplace_back();
+        auto it = graph.first[v];
+        if (it != sample_graph_t::none)
+            do {
+                out_graph.vertices.back().push_back(sample_graph_t::edge_of(it));
+                it = graph.next[it];
+            } while (it != graph.first[v]);
+        out_graph.labels.push_back(std::to_string(v + 1));
+    }
+    for (const auto &e : graph.edges)
+        out_graph.edges.push_back({ e.tail, e.head });
+    out_graph.update_neighbor_index();
+    return out_graph;
+}
+
+size_t code_size(const std::vector<bool> &bitstring)
+{
+    const size_t n = (bitstring.size() + 2) / 4;
+    if (n < 2 || bitstring.size() != 4 * n - 2
+            || size_t(std::count(bitstring.begin(), bitstring.end(), true)) != n - 1)
+        return 0;
+    return n;
+}
+
+graph_t decode_triangulation(const std::vector<bool> &bitstring)
+{
+    sample_graph_t graph = code_to_tree(find_permutation(bitstring));
+    const size_t v0 = complete_closure(graph);
+    make_bimodal(graph);
+    return to_graph(graph, v0);
+}
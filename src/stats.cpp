@@ -0,0 +1,54 @@
+#include <algorithm>
+#include "include/stats.hpp"
+
+tree_stats_t tree_stats(const four_block_tree_t &four_block_tree)
+{
+    tree_stats_t stats{ four_block_tree.size(), 0, {} };
+    /* parents come before their children */
+    std::vector<size_t> depth(four_block_tree.size(), 0);
+    for (size_t i = 0; i < four_block_tree.size(); ++i)
+    {
+        if (i != 0)
+            depth[i] = depth[four_block_tree[i].parent] + 1;
+        stats.depth = std::max(stats.depth, depth[i]);
+
+        size_t bucket = 0;
+        while (four_block_tree[i].num_vertices() >> (bucket + 1) != 0)
+            ++bucket;
+        if (stats.size_histogram.size() <= bucket)
+            stats.size_histogram.resize(bucket + 1, 0);
+        ++stats.size_histogram[bucket];
+    }
+    return stats;
+}
+
+void write_stats(std::ostream &os, const tree_stats_t &tree, const drawing_counts_t &counts, const l_drawing_t &drawing)
+{
+    static const char *const outer_face_name[] = { "h_shape", "long_sink", "t_shape", "long_source" };
+
+    os << "{\n  \"separating_triangles\": " << tree.components - 1
+        << ",\n  \"components\": " << tree.components
+        << ",\n  \"component_sizes\": {";
+    bool first = true;
+    for (size_t bucket = 0; bucket < tree.size_histogram.size(); ++bucket)
+        if (tree.size_histogram[bucket] != 0)
+        {
+            os << (first ? " \"" : ", \"") << (size_t(1) << bucket) << "\": " << tree.size_histogram[bucket];
+            first = false;
+        }
+    os << " },\n  \"tree_depth\": " << tree.depth
+        << ",\n  \"outer_faces\": {";
+    for (unsigned of = 0; of < 4; ++of)
+        os << (of == 0 ? " \"" : ", \"") << outer_face_name[of] << "\": " << counts.outer_face[of];
+    os << " },\n  \"extra_rules\": " << counts.extra_rules
+        << ",\n  \"postponed_vertices\": " << counts.postponed_vertices
+        << ",\n  \"virtual_vertices\": " << counts.virtual_vertices;
+
+    coord_t width = 0, height = 0;
+    for (const position_t &p : drawing)
+    {
+        width = std::max(width, p.x + 1);
+        height = std::max(height, p.y + 1);
+    }
+    os << ",\n  \"width\": " << width << ",\n  \"height\": " << height << "\n}" << std::endl;
+}
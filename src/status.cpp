@@ -0,0 +1,14 @@
+#include "include/status.hpp"
+
+thread_local std::string last_error_message;
+
+status_t fail(status_t status, const std::string &message)
+{
+    last_error_message = message;
+    return status;
+}
+
+const std::string &error_message(void)
+{
+    return last_error_message;
+}
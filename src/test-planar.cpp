@@ -1,3 +1,4 @@
+#include <chrono>
 #include <string>
 #include <iostream>
 #include <sstream>
@@ -5,121 +6,101 @@
 #include "include/port_assignment.hpp"
 #include "include/rectangular_dual.hpp"
 #include "include/decompose.hpp"
+#include "include/io.hpp"
+#include "include/verify.hpp"
 
-graph_t read_graph(std::istream &is)
+l_drawing_t read_drawing(std::istream &is)
 {
-    graph_t out_graph;
-    size_t line_num = 0;
-    auto error = [&]()
-    {
-        std::cerr << "Error reading input on line " << line_num << std::endl;
-        exit(1);
-    };
-    std::string line;
+    l_drawing_t drawing;
+    coord_t x, y;
+    while (is >> x >> y)
+        drawing.push_back({ x, y });
+    return drawing;
+}
 
-    /* header */
-    ++line_num;
-    std::getline(is, line);
-    size_t num_vertices, num_edges, outer_face_degree;
-    if (!(std::istringstream(line) >> num_vertices >> num_edges >> outer_face_degree))
-        error();
-    out_graph.vertices.clear();
-    out_graph.edges.clear();
-    out_graph.labels.clear();
-    out_graph.outer_face.clear();
-    out_graph.vertices.resize(num_vertices);
-    out_graph.edges.reserve(num_edges);
-    out_graph.labels.reserve(num_vertices);
-    out_graph.outer_face.reserve(outer_face_degree);
+rectangular_dual_t read_rect_dual(std::istream &is)
+{
+    rectangular_dual_t dual;
+    coord_t x_min, y_min, x_max, y_max;
+    while (is >> x_min >> y_min >> x_max >> y_max)
+        dual.push_back({ x_min, y_min, x_max, y_max });
+    return dual;
+}
 
-    /* outer face */
-    ++line_num;
-    std::getline(is, line);
-    std::istringstream iss(line);
-    vertex_t v1;
-    while (iss >> v1)
-        out_graph.outer_face.push_back(v1 - 1);
+void usage(char *name)
+{
+    std::cerr << "usage: " << name << " [ --threads n ] [ --report | --all ] | --rect-dual" << std::endl;
+    exit(2);
+}
 
-    /* labels */
-    for (vertex_t v = 0; v < num_vertices; ++v)
+int main(int argc, char **argv)
+{
+    check_mode_t mode = check_mode_t::FIRST;
+    unsigned num_threads = 1;
+    bool rect_dual = false;
+    for (int i = 1; i < argc; ++i)
     {
-        ++line_num;
-        std::getline(is, line);
-        out_graph.labels.push_back(line);
+        const std::string arg(argv[i]);
+        if (arg == "--rect-dual")
+            rect_dual = true;
+        else if (arg == "--all")
+            mode = check_mode_t::LIST;
+        else if (arg == "--report")
+            mode = check_mode_t::COUNT;
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            if (!(std::istringstream(argv[++i]) >> num_threads) || num_threads == 0)
+                usage(argv[0]);
+        }
+        else
+            usage(argv[0]);
     }
 
-    /* edges */
-    for (size_t e = 0; e < num_edges; ++e)
+    graph_t graph;
+    if (read_graph(std::cin, graph) != status_t::OK)
     {
-        ++line_num;
-        std::getline(is, line);
-        vertex_t tail1, head1;
-        if (!(std::istringstream(line) >> tail1 >> head1))
-            error();
-        out_graph.edges.push_back({ tail1 - 1, head1 - 1 });
+        std::cerr << error_message() << std::endl;
+        exit(1);
     }
-
-    /* embedding */
-    for (vertex_t v = 0; v < num_vertices; ++v)
+    if (rect_dual)
     {
-        ++line_num;
-        std::getline(is, line);
-        iss = std::istringstream(line);
-        size_t e1;
-        while (iss >> e1)
-            out_graph.vertices[v].push_back(e1 - 1);
+        if (check_rect_dual(graph, read_rect_dual(std::cin)) == status_t::OK)
+            return 0;
+        std::cerr << error_message() << std::endl;
+        return 1;
     }
+    l_drawing_t drawing = read_drawing(std::cin);
 
-    out_graph.update_neighbor_index();
+    const auto start = std::chrono::steady_clock::now();
+    const report_t report = check_crossings(graph, drawing, mode, num_threads);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
 
-    return out_graph;
-}
-
-l_drawing_t read_drawing(std::istream &is)
-{
-    l_drawing_t drawing;
-    coord_t x, y;
-    while (is >> x >> y)
-        drawing.push_back({ x, y });
-    return drawing;
-}
-
-int is_planar(const graph_t graph, const l_drawing_t drawing)
-{
-    struct horizontal_segment_t { coord_t y, from, to; };
-    struct vertical_segment_t   { coord_t x, from, to; };
-    std::vector<horizontal_segment_t> horiz;
-    std::vector<vertical_segment_t> vert;
-    for (const edge_t &e : graph.edges)
+    switch (mode)
     {
-        if (drawing[e.tail].x < drawing[e.head].x)
-            horiz.push_back({ drawing[e.head].y, drawing[e.tail].x, drawing[e.head].x });
-        else
-            horiz.push_back({ drawing[e.head].y, drawing[e.head].x, drawing[e.tail].x });
-        if (drawing[e.tail].y < drawing[e.head].y)
-            vert.push_back({ drawing[e.tail].x, drawing[e.tail].y, drawing[e.head].y });
-        else
-            vert.push_back({ drawing[e.tail].x, drawing[e.head].y, drawing[e.tail].y });
-    }
-    for (const auto &h : horiz)
-        for (const auto &v : vert)
-            if (h.from < v.x && v.x < h.to
-                    && v.from < h.y && h.y < v.to)
-            {
+        case check_mode_t::FIRST:
 #ifdef DEBUG_PRINT
-                std::cerr << "segments h" << h.y << '[' << h.from << ',' << h.to << ']'
-                    << " and v" << v.x << '[' << v.from << ',' << v.to << "] intersect"
-                    << std::endl;
+            if (report.num_crossings != 0)
+                std::cerr << report.first << std::endl;
 #endif // DEBUG_PRINT
-                return 1;
-            }
+            break;
+        case check_mode_t::LIST:
+            for (const crossing_t &crossing : report.crossings)
+                std::cerr << crossing << std::endl;
+            std::cerr << report.num_crossings << " crossings" << std::endl;
+            break;
+        case check_mode_t::COUNT:
+            std::cout << "crossings\t" << report.num_crossings << std::endl;
+            if (report.num_crossings != 0)
+                std::cout << "first\t" << report.first << std::endl;
+            std::cout << "time\t" << elapsed.count() << std::endl;
+            break;
+    }
+    if (report.num_crossings != 0)
+        return 1;
+    if (check_extents(graph, drawing) != status_t::OK)
+    {
+        std::cerr << error_message() << std::endl;
+        return 1;
+    }
     return 0;
 }
-
-int main(void)
-{
-    graph_t graph = read_graph(std::cin);
-    l_drawing_t drawing = read_drawing(std::cin);
-
-    return is_planar(graph, drawing);
-}
@@ -1,10 +1,91 @@
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "include/alloc_stats.hpp"
 #include "include/timer.hpp"
 
-std::chrono::time_point<std::chrono::steady_clock> timer::start_point[4] = { {}, {}, {}, {} };
-double timer::duration[4] = { 0.0, 0.0, 0.0, 0.0 };
+const unsigned num_activities = 6;
+
+thread_local std::chrono::time_point<std::chrono::steady_clock> timer::start_point[num_activities] = {};
+
+const char *const activity_name[num_activities] = { "io", "decompose", "rect_dual", "port_assignment", "verify", "compact" };
+
+/* the allocations of the whole program when the activity started on this thread */
+thread_local alloc_stats_t start_allocs[num_activities];
+
+/* the perf counters when the activity started on this thread; 0 unless counting */
+size_t num_perf_counters = 0;
+thread_local uint64_t start_counters[num_activities][max_perf_counters];
+
+/* what each activity took, summed over the threads or per thread */
+struct activity_totals_t {
+    double duration[num_activities] = {};
+    size_t allocations[num_activities] = {}, bytes[num_activities] = {}, peak_live_bytes[num_activities] = {}; // only with ALLOC_STATS
+    uint64_t counters[num_activities][max_perf_counters] = {}; // only when counting perf events
+};
+
+struct event_t {
+    std::string path;
+    double begin, end; // in seconds since the program started
+    size_t allocations, bytes, peak_live_bytes; // only with ALLOC_STATS
+    std::vector<uint64_t> counters; // only when counting perf events
+};
+
+/* The activities and phases a thread has finished.  A thread only ever adds
+ * to its own log, and the logs are kept beyond the end of their threads, so
+ * they can be written after all threads are joined. */
+struct thread_log_t {
+    unsigned thread;
+    activity_totals_t activities;
+    std::vector<event_t> events;
+};
+
+std::mutex logs_mutex;
+std::vector<std::shared_ptr<thread_log_t>> logs;
+thread_local std::shared_ptr<thread_log_t> log_of_thread;
+
+thread_log_t &thread_log(void)
+{
+    if (!log_of_thread)
+    {
+        std::lock_guard<std::mutex> lock(logs_mutex);
+        log_of_thread = std::make_shared<thread_log_t>();
+        log_of_thread->thread = logs.size();
+        logs.push_back(log_of_thread);
+    }
+    return *log_of_thread;
+}
+
+/* the activities of all threads, with the largest peak of any thread */
+activity_totals_t sum_activities(void)
+{
+    activity_totals_t out_totals;
+    std::lock_guard<std::mutex> lock(logs_mutex);
+    for (const auto &log : logs)
+        for (unsigned act = 0; act < num_activities; ++act)
+        {
+            const activity_totals_t &activities = log->activities;
+            out_totals.duration[act] += activities.duration[act];
+            out_totals.allocations[act] += activities.allocations[act];
+            out_totals.bytes[act] += activities.bytes[act];
+            out_totals.peak_live_bytes[act] = std::max(out_totals.peak_live_bytes[act], activities.peak_live_bytes[act]);
+            for (size_t i = 0; i < num_perf_counters; ++i)
+                out_totals.counters[act][i] += activities.counters[act][i];
+        }
+    return out_totals;
+}
 
 void timer::start(activity_t act)
 {
+#ifdef ALLOC_STATS
+    start_allocs[act] = alloc_stats();
+#endif // ALLOC_STATS
+    if (num_perf_counters != 0)
+        read_perf_counters(start_counters[act]);
     start_point[act] = std::chrono::steady_clock::now();
 }
 
@@ -12,14 +93,266 @@ void timer::stop(activity_t act)
 {
     auto end_point = std::chrono::steady_clock::now();
     std::chrono::duration<double> diff = end_point - start_point[act];
-    duration[act] += diff.count();
+    activity_totals_t &activities = thread_log().activities;
+    activities.duration[act] += diff.count();
+    if (num_perf_counters != 0)
+    {
+        uint64_t now[max_perf_counters];
+        read_perf_counters(now);
+        for (size_t i = 0; i < num_perf_counters; ++i)
+            activities.counters[act][i] += now[i] - start_counters[act][i];
+    }
+#ifdef ALLOC_STATS
+    const alloc_stats_t stats = alloc_stats();
+    activities.allocations[act] += stats.allocations - start_allocs[act].allocations;
+    activities.bytes[act] += stats.bytes - start_allocs[act].bytes;
+#endif // ALLOC_STATS
 }
 
 void timer::print_times(std::ostream &os)
 {
+    const activity_totals_t activities = sum_activities();
     os
-        << duration[IO] << ' '
-        << duration[DECOMPOSE] << ' '
-        << duration[RECT_DUAL] << ' '
-        << duration[PORT_ASSIGNMENT] << std::endl;
+        << activities.duration[IO] << ' '
+        << activities.duration[DECOMPOSE] << ' '
+        << activities.duration[RECT_DUAL] << ' '
+        << activities.duration[PORT_ASSIGNMENT] << ' '
+        << activities.duration[VERIFY] << ' '
+        << activities.duration[COMPACT];
+#ifdef ALLOC_STATS
+    for (unsigned act = 0; act < num_activities; ++act)
+        os << ' ' << activities.allocations[act] << ' ' << activities.bytes[act] << ' ' << activities.peak_live_bytes[act];
+#endif // ALLOC_STATS
+    os << std::endl;
+}
+
+const std::chrono::time_point<std::chrono::steady_clock> epoch = std::chrono::steady_clock::now();
+std::atomic<bool> recording(false);
+
+thread_local std::string current_path;
+thread_local int current_activity = -1;
+
+timer::scope::scope(const char *name, int act)
+    : path_length(current_path.size()), activity(act), outer_activity(current_activity)
+{
+    if (recording)
+    {
+        if (path_length != 0)
+            current_path += '/';
+        current_path += name;
+    }
+    if (activity >= 0)
+    {
+        if (outer_activity >= 0)
+            stop(activity_t(outer_activity));
+        start(activity_t(activity));
+        current_activity = activity;
+    }
+#ifdef ALLOC_STATS
+    const alloc_stats_t stats = alloc_stats();
+    begin_allocations = stats.allocations;
+    begin_bytes = stats.bytes;
+    outer_peak_live_bytes = begin_peak_live_bytes();
+#endif // ALLOC_STATS
+    /* the activity has just read the counters */
+    if (num_perf_counters != 0 && activity >= 0)
+        std::copy(start_counters[activity], start_counters[activity] + num_perf_counters, begin_counters);
+    else if (num_perf_counters != 0)
+        read_perf_counters(begin_counters);
+    begin = std::chrono::steady_clock::now();
+}
+
+timer::scope::~scope()
+{
+    const auto end = std::chrono::steady_clock::now();
+#ifdef ALLOC_STATS
+    const size_t peak_live_bytes = end_peak_live_bytes(outer_peak_live_bytes);
+    if (activity >= 0)
+    {
+        size_t &activity_peak = thread_log().activities.peak_live_bytes[activity];
+        activity_peak = std::max(activity_peak, peak_live_bytes);
+    }
+#endif // ALLOC_STATS
+    if (activity >= 0)
+    {
+        stop(activity_t(activity));
+        if (outer_activity >= 0)
+            start(activity_t(outer_activity));
+        current_activity = outer_activity;
+    }
+    if (recording && current_path.size() > path_length)
+    {
+        const std::chrono::duration<double> from_epoch = begin - epoch, to_epoch = end - epoch;
+        event_t event { current_path, from_epoch.count(), to_epoch.count(), 0, 0, 0, {} };
+        if (num_perf_counters != 0)
+        {
+            event.counters.resize(num_perf_counters);
+            read_perf_counters(event.counters.data());
+            for (size_t i = 0; i < num_perf_counters; ++i)
+                event.counters[i] -= begin_counters[i];
+        }
+#ifdef ALLOC_STATS
+        const alloc_stats_t stats = alloc_stats();
+        event.allocations = stats.allocations - begin_allocations;
+        event.bytes = stats.bytes - begin_bytes;
+        event.peak_live_bytes = peak_live_bytes;
+#endif // ALLOC_STATS
+        thread_log().events.push_back(std::move(event));
+        current_path.resize(path_length);
+    }
+}
+
+void timer::record(void)
+{
+    recording = true;
+}
+
+size_t timer::count_perf_events(void)
+{
+    num_perf_counters = open_perf_counters();
+    return num_perf_counters;
+}
+
+struct phase_t {
+    unsigned thread;
+    std::string path;
+    size_t count = 0;
+    double seconds = 0.0;
+    size_t allocations = 0, bytes = 0, peak_live_bytes = 0;
+    uint64_t counters[max_perf_counters] = {};
+};
+
+/* the events of each thread summed by their path, in order of the threads and
+ * then of the paths, so that subphases follow their phase */
+std::vector<phase_t> sum_phases(void)
+{
+    std::vector<phase_t> out_phases;
+    std::lock_guard<std::mutex> lock(logs_mutex);
+    for (const auto &log : logs)
+    {
+        std::map<std::string, phase_t> phases;
+        for (const event_t &event : log->events)
+        {
+            phase_t &phase = phases[event.path];
+            ++phase.count;
+            phase.seconds += event.end - event.begin;
+            phase.allocations += event.allocations;
+            phase.bytes += event.bytes;
+            phase.peak_live_bytes = std::max(phase.peak_live_bytes, event.peak_live_bytes);
+            for (size_t i = 0; i < event.counters.size(); ++i)
+                phase.counters[i] += event.counters[i];
+        }
+        for (auto &[path, phase] : phases)
+        {
+            phase.thread = log->thread;
+            phase.path = path;
+            out_phases.push_back(phase);
+        }
+    }
+    return out_phases;
+}
+
+void write_json_counters(std::ostream &os, const uint64_t *values)
+{
+    os << "{";
+    for (size_t i = 0; i < num_perf_counters; ++i)
+        os << (i == 0 ? " \"" : ", \"") << perf_counter_names()[i] << "\": " << values[i];
+    os << " }";
+}
+
+void timer::write_json(std::ostream &os)
+{
+    const activity_totals_t activities = sum_activities();
+    os << "{\n  \"activities\": {";
+    for (unsigned act = 0; act < num_activities; ++act)
+        os << (act == 0 ? "" : ",") << "\n    \"" << activity_name[act] << "\": " << activities.duration[act];
+    os << "\n  },";
+#ifdef ALLOC_STATS
+    os << "\n  \"allocations\": {";
+    for (unsigned act = 0; act < num_activities; ++act)
+        os << (act == 0 ? "" : ",") << "\n    \"" << activity_name[act] << "\": { \"count\": " << activities.allocations[act]
+            << ", \"bytes\": " << activities.bytes[act] << ", \"peak_live_bytes\": " << activities.peak_live_bytes[act] << " }";
+    os << "\n  },";
+#endif // ALLOC_STATS
+    if (num_perf_counters != 0)
+    {
+        os << "\n  \"counters\": {";
+        for (unsigned act = 0; act < num_activities; ++act)
+        {
+            os << (act == 0 ? "" : ",") << "\n    \"" << activity_name[act] << "\": ";
+            write_json_counters(os, activities.counters[act]);
+        }
+        os << "\n  },";
+    }
+    os << "\n  \"phases\": [";
+    bool first = true;
+    for (const phase_t &phase : sum_phases())
+    {
+        os << (first ? "" : ",") << "\n    { \"name\": \"" << phase.path << "\", \"thread\": " << phase.thread
+            << ", \"count\": " << phase.count << ", \"seconds\": " << phase.seconds;
+#ifdef ALLOC_STATS
+        os << ", \"allocations\": " << phase.allocations << ", \"bytes\": " << phase.bytes
+            << ", \"peak_live_bytes\": " << phase.peak_live_bytes;
+#endif // ALLOC_STATS
+        if (num_perf_counters != 0)
+        {
+            os << ", \"counters\": ";
+            write_json_counters(os, phase.counters);
+        }
+        os << " }";
+        first = false;
+    }
+    os << "\n  ]\n}" << std::endl;
+}
+
+void timer::write_counters(std::ostream &os)
+{
+    os << "phase\tthread\tcount\tseconds";
+    for (const std::string &name : perf_counter_names())
+        os << '\t' << name;
+    os << '\n';
+    const activity_totals_t activities = sum_activities();
+    for (unsigned act = 0; act < num_activities; ++act)
+    {
+        os << '[' << activity_name[act] << "]\t\t\t" << activities.duration[act];
+        for (size_t i = 0; i < num_perf_counters; ++i)
+            os << '\t' << activities.counters[act][i];
+        os << '\n';
+    }
+    for (const phase_t &phase : sum_phases())
+    {
+        os << phase.path << '\t' << phase.thread << '\t' << phase.count << '\t' << phase.seconds;
+        for (size_t i = 0; i < num_perf_counters; ++i)
+            os << '\t' << phase.counters[i];
+        os << '\n';
+    }
+    os << std::flush;
+}
+
+void timer::write_trace(std::ostream &os)
+{
+    os << std::fixed << std::setprecision(3);
+    os << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+    bool first = true;
+    std::lock_guard<std::mutex> lock(logs_mutex);
+    for (const auto &log : logs)
+        for (const event_t &event : log->events)
+        {
+            const size_t slash = event.path.rfind('/');
+            os << (first ? "" : ",") << "\n{\"name\": \""
+                << (slash == std::string::npos ? event.path : event.path.substr(slash + 1))
+                << "\", \"cat\": \"" << event.path.substr(0, event.path.find('/'))
+                << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << log->thread
+                << ", \"ts\": " << event.begin * 1e6 << ", \"dur\": " << (event.end - event.begin) * 1e6
+                << ", \"args\": {\"path\": \"" << event.path << '"';
+#ifdef ALLOC_STATS
+            os << ", \"allocations\": " << event.allocations << ", \"bytes\": " << event.bytes
+                << ", \"peak_live_bytes\": " << event.peak_live_bytes;
+#endif // ALLOC_STATS
+            for (size_t i = 0; i < num_perf_counters; ++i)
+                os << ", \"" << perf_counter_names()[i] << "\": " << event.counters[i];
+            os << "}}";
+            first = false;
+        }
+    os << "\n]}" << std::endl;
 }
@@ -0,0 +1,350 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include "include/timer.hpp"
+#include "include/verify.hpp"
+
+std::ostream &operator<<(std::ostream &os, const crossing_t &c)
+{
+    return os << "segments h" << c.h.y << '[' << c.h.from << ',' << c.h.to << ']'
+        << " and v" << c.v.x << '[' << c.v.from << ',' << c.v.to << "] intersect";
+}
+
+/* Splits the plane into vertical strips holding about the same number of
+ * vertical segments.  Within each strip a vertical line is swept from left to
+ * right, keeping the horizontal segments it currently crosses ordered by y.
+ * Horizontal segments spanning several strips are clipped to each of them.
+ * The strips are handed out to num_threads threads.  Only proper crossings
+ * count, segments that merely touch do not.  In FIRST mode a strip stops at
+ * its first crossing, and strips to the right of a strip with a crossing are
+ * skipped, but those to its left are still swept, so that the first crossing
+ * reported is the leftmost for any number of threads. */
+report_t check_crossings(const graph_t &graph, const l_drawing_t &drawing,
+    check_mode_t mode, unsigned num_threads)
+{
+    std::vector<horizontal_segment_t> horiz;
+    std::vector<vertical_segment_t> vert;
+    for (const edge_t &e : graph.edges)
+    {
+        if (drawing[e.tail].x < drawing[e.head].x)
+            horiz.push_back({ drawing[e.head].y, drawing[e.tail].x, drawing[e.head].x });
+        else
+            horiz.push_back({ drawing[e.head].y, drawing[e.head].x, drawing[e.tail].x });
+        if (drawing[e.tail].y < drawing[e.head].y)
+            vert.push_back({ drawing[e.tail].x, drawing[e.tail].y, drawing[e.head].y });
+        else
+            vert.push_back({ drawing[e.tail].x, drawing[e.head].y, drawing[e.tail].y });
+    }
+
+    /* strip k covers boundaries[k] <= x < boundaries[k + 1] */
+    const size_t num_strips = num_threads == 1 ? 1 : 4 * num_threads;
+    std::vector<coord_t> boundaries { 0 };
+    {
+        std::vector<coord_t> xs;
+        xs.reserve(vert.size());
+        for (const vertical_segment_t &v : vert)
+            xs.push_back(v.x);
+        std::sort(xs.begin(), xs.end());
+        for (size_t k = 1; k < num_strips && !xs.empty(); ++k)
+            boundaries.push_back(xs[xs.size() * k / num_strips]);
+        boundaries.push_back(std::numeric_limits<coord_t>::max());
+    }
+    auto strip_of = [&](coord_t x) -> size_t
+    {
+        return std::upper_bound(boundaries.begin(), boundaries.end(), x) - boundaries.begin() - 1;
+    };
+    std::vector<std::vector<size_t>> strip_horiz(num_strips), strip_vert(num_strips);
+    for (size_t i = 0; i < vert.size(); ++i)
+        if (vert[i].from + 1 < vert[i].to)
+            strip_vert[strip_of(vert[i].x)].push_back(i);
+    /* a horizontal segment is crossed by the sweep line strictly between its
+     * end points */
+    for (size_t i = 0; i < horiz.size(); ++i)
+        if (horiz[i].from + 1 < horiz[i].to)
+            for (size_t k = strip_of(horiz[i].from + 1); k <= strip_of(horiz[i].to - 1); ++k)
+                strip_horiz[k].push_back(i);
+
+    /* at equal x, segments are removed before and inserted after the vertical
+     * segments there are checked; a segment clipped at the left boundary of
+     * the strip is already crossed there */
+    enum event_kind_t : char { REMOVE, ENTER, QUERY, INSERT };
+    struct event_t { coord_t x; event_kind_t kind; size_t segment; };
+
+    std::vector<report_t> strip_reports(num_strips);
+    std::atomic<size_t> next_strip(0);
+    /* the leftmost strip known to have a crossing, only used in FIRST mode */
+    std::atomic<size_t> first_strip_found(num_strips);
+    auto sweep_strips = [&]()
+    {
+        std::vector<event_t> events;
+        std::set<std::pair<coord_t,size_t>> active;
+        for (size_t k; (k = next_strip++) < num_strips; )
+        {
+            /* the strips are claimed from left to right */
+            if (mode == check_mode_t::FIRST && k > first_strip_found)
+                return;
+            report_t &report = strip_reports[k];
+            events.clear();
+            active.clear();
+            for (size_t i : strip_horiz[k])
+            {
+                if (horiz[i].from < boundaries[k])
+                    events.push_back({ boundaries[k], ENTER, i });
+                else
+                    events.push_back({ horiz[i].from, INSERT, i });
+                if (horiz[i].to < boundaries[k + 1])
+                    events.push_back({ horiz[i].to, REMOVE, i });
+            }
+            for (size_t i : strip_vert[k])
+                events.push_back({ vert[i].x, QUERY, i });
+            std::sort(events.begin(), events.end(), [](const event_t &a, const event_t &b)
+            {
+                if (a.x != b.x)
+                    return a.x < b.x;
+                return a.kind < b.kind || (a.kind == b.kind && a.segment < b.segment);
+            });
+
+            for (const event_t &event : events)
+                switch (event.kind)
+                {
+                    case REMOVE:
+                        active.erase({ horiz[event.segment].y, event.segment });
+                        break;
+                    case ENTER:
+                    case INSERT:
+                        active.insert({ horiz[event.segment].y, event.segment });
+                        break;
+                    case QUERY:
+                    {
+                        const vertical_segment_t &v = vert[event.segment];
+                        for (auto it = active.upper_bound({ v.from, SIZE_MAX });
+                                it != active.end() && it->first < v.to; ++it)
+                        {
+                            const crossing_t crossing { horiz[it->second], v };
+                            if (report.num_crossings++ == 0)
+                                report.first = crossing;
+                            if (mode == check_mode_t::LIST)
+                                report.crossings.push_back(crossing);
+                            else if (mode == check_mode_t::FIRST)
+                            {
+                                size_t first = first_strip_found;
+                                while (k < first && !first_strip_found.compare_exchange_weak(first, k))
+                                    ;
+                                return;
+                            }
+                        }
+                        break;
+                    }
+                }
+        }
+    };
+
+    /* the workers' phases are named as if nested in the caller's */
+    std::vector<std::thread> threads;
+    for (unsigned t = 1; t < num_threads; ++t)
+        threads.emplace_back([&]()
+        {
+            timer::scope phase("verify/strips");
+            sweep_strips();
+        });
+    {
+        timer::scope phase("strips");
+        sweep_strips();
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+
+    /* combine in order of the strips, so the result is the same for any
+     * number of threads */
+    report_t out_report;
+    for (report_t &report : strip_reports)
+    {
+        if (mode == check_mode_t::FIRST && out_report.num_crossings != 0)
+            break;
+        if (out_report.num_crossings == 0 && report.num_crossings != 0)
+            out_report.first = report.first;
+        out_report.num_crossings += report.num_crossings;
+        out_report.crossings.insert(out_report.crossings.end(),
+            report.crossings.begin(), report.crossings.end());
+    }
+    return out_report;
+}
+
+/* Checks that the rectangles tile their bounding box and that two of them
+ * share a piece of boundary exactly if their vertices are adjacent.  Returns
+ * status_t::OK if so, otherwise fails with the first problem. */
+status_t check_rect_dual(const graph_t &graph, const rectangular_dual_t &dual)
+{
+    auto invalid = [](const std::string &message)
+    {
+        return fail(status_t::INVALID_DRAWING, message);
+    };
+    const size_t n = graph.num_vertices();
+    if (dual.size() != n)
+        return invalid("expected " + std::to_string(n) + " rectangles, got " + std::to_string(dual.size()));
+    if (n == 0)
+        return status_t::OK;
+
+    /* no overlaps and no gaps: the rectangles are disjoint and their areas add
+     * up to the area of the bounding box */
+    rectangle_t bounding_box = dual[0];
+    unsigned long long area = 0;
+    for (vertex_t v = 0; v < n; ++v)
+    {
+        const rectangle_t &r = dual[v];
+        if (r.x_min >= r.x_max || r.y_min >= r.y_max)
+            return invalid("rectangle of " + graph.labels[v] + " is empty");
+        bounding_box.x_min = std::min(bounding_box.x_min, r.x_min);
+        bounding_box.y_min = std::min(bounding_box.y_min, r.y_min);
+        bounding_box.x_max = std::max(bounding_box.x_max, r.x_max);
+        bounding_box.y_max = std::max(bounding_box.y_max, r.y_max);
+        area += (unsigned long long)(r.x_max - r.x_min) * (r.y_max - r.y_min);
+    }
+    if (area != (unsigned long long)(bounding_box.x_max - bounding_box.x_min)
+            * (bounding_box.y_max - bounding_box.y_min))
+        return invalid("rectangles do not tile their bounding box");
+
+    /* sweep from left to right, keeping the y-intervals of the rectangles the
+     * sweep line currently crosses; a rectangle is left at its x_max before the
+     * ones starting there are entered */
+    struct event_t { coord_t x; bool enter; vertex_t v; };
+    std::vector<event_t> events;
+    events.reserve(2 * n);
+    for (vertex_t v = 0; v < n; ++v)
+    {
+        events.push_back({ dual[v].x_min, true,  v });
+        events.push_back({ dual[v].x_max, false, v });
+    }
+    std::sort(events.begin(), events.end(), [](const event_t &a, const event_t &b)
+    {
+        return a.x < b.x || (a.x == b.x && a.enter < b.enter);
+    });
+    std::set<std::pair<coord_t,vertex_t>> active; // y_min, vertex
+    for (const event_t &event : events)
+    {
+        const rectangle_t &r = dual[event.v];
+        if (!event.enter)
+        {
+            active.erase({ r.y_min, event.v });
+            continue;
+        }
+        auto next = active.lower_bound({ r.y_min, 0 });
+        vertex_t other = event.v;
+        if (next != active.end() && next->first < r.y_max)
+            other = next->second;
+        else if (next != active.begin() && dual[std::prev(next)->second].y_max > r.y_min)
+            other = std::prev(next)->second;
+        if (other != event.v)
+            return invalid("rectangles of " + graph.labels[other] + " and " + graph.labels[event.v] + " overlap");
+        active.insert({ r.y_min, event.v });
+    }
+
+    /* Rectangles can only touch along a common coordinate, so the sides are
+     * bucketed by it.  Per bucket, the sides of the rectangles below (left)
+     * and above (right) of it are merged by position to find the pairs that
+     * share a piece of positive length. */
+    struct side_t { coord_t from, to; vertex_t v; };
+    typedef std::unordered_map<coord_t,std::pair<std::vector<side_t>,std::vector<side_t>>> sides_t;
+    std::unordered_set<unsigned long long> edges, found;
+    auto key = [&](vertex_t u, vertex_t v) -> unsigned long long
+    {
+        return (unsigned long long)std::min(u, v) * n + std::max(u, v);
+    };
+    for (const edge_t &e : graph.edges)
+        edges.insert(key(e.tail, e.head));
+    auto find_adjacencies = [&](sides_t &sides) -> bool
+    {
+        auto by_from = [](const side_t &a, const side_t &b) { return a.from < b.from; };
+        for (auto &bucket : sides)
+        {
+            std::vector<side_t> &lower = bucket.second.first;
+            std::vector<side_t> &upper = bucket.second.second;
+            std::sort(lower.begin(), lower.end(), by_from);
+            std::sort(upper.begin(), upper.end(), by_from);
+            for (size_t i = 0, j = 0; i < lower.size() && j < upper.size(); )
+            {
+                if (std::max(lower[i].from, upper[j].from) < std::min(lower[i].to, upper[j].to))
+                {
+                    const unsigned long long k = key(lower[i].v, upper[j].v);
+                    if (edges.count(k) == 0)
+                    {
+                        invalid("rectangles of " + graph.labels[lower[i].v] + " and "
+                            + graph.labels[upper[j].v] + " touch, but the vertices are not adjacent");
+                        return false;
+                    }
+                    found.insert(k);
+                }
+                if (lower[i].to < upper[j].to)
+                    ++i;
+                else
+                    ++j;
+            }
+        }
+        return true;
+    };
+    sides_t vertical_sides, horizontal_sides;
+    for (vertex_t v = 0; v < n; ++v)
+    {
+        const rectangle_t &r = dual[v];
+        vertical_sides[r.x_max].first.push_back({ r.y_min, r.y_max, v });
+        vertical_sides[r.x_min].second.push_back({ r.y_min, r.y_max, v });
+        horizontal_sides[r.y_max].first.push_back({ r.x_min, r.x_max, v });
+        horizontal_sides[r.y_min].second.push_back({ r.x_min, r.x_max, v });
+    }
+    if (!find_adjacencies(vertical_sides) || !find_adjacencies(horizontal_sides))
+        return status_t::INVALID_DRAWING;
+    /* found only has pairs of adjacent vertices */
+    if (found.size() != edges.size())
+        for (const edge_t &e : graph.edges)
+            if (found.count(key(e.tail, e.head)) == 0)
+                return invalid("vertices " + graph.labels[e.tail] + " and " + graph.labels[e.head]
+                    + " are adjacent, but their rectangles do not touch");
+    return status_t::OK;
+}
+
+/* Within each column the vertical extents, i.e. a vertex together with its
+ * outgoing vertical segments, must be disjoint, and so must the horizontal
+ * extents within each row, i.e. a vertex together with its incoming horizontal
+ * segments.  Both are sorted by line and then by start, so only neighbors need
+ * to be compared.  Returns status_t::OK if so, otherwise fails with the first
+ * line in which two extents touch. */
+status_t check_extents(const graph_t &graph, const l_drawing_t &drawing)
+{
+    const size_t n = graph.num_vertices();
+    if (drawing.size() != n)
+        return fail(status_t::INVALID_DRAWING, "expected " + std::to_string(n) + " vertices, got " + std::to_string(drawing.size()));
+
+    struct extent_t { coord_t line, min, max; vertex_t v; };
+    std::vector<extent_t> extents(n);
+    auto check = [&](coord_t position_t::*along, coord_t position_t::*across, bool outgoing, const char *line_name)
+    {
+        for (vertex_t v = 0; v < n; ++v)
+            extents[v] = { drawing[v].*along, drawing[v].*across, drawing[v].*across, v };
+        for (const edge_t &e : graph.edges)
+        {
+            extent_t &extent = extents[outgoing ? e.tail : e.head];
+            const coord_t c = drawing[outgoing ? e.head : e.tail].*across;
+            extent.min = std::min(extent.min, c);
+            extent.max = std::max(extent.max, c);
+        }
+        std::sort(extents.begin(), extents.end(), [](const extent_t &a, const extent_t &b)
+        {
+            return a.line != b.line ? a.line < b.line : a.min < b.min;
+        });
+        for (size_t i = 1; i < n; ++i)
+            if (extents[i].line == extents[i - 1].line && extents[i].min <= extents[i - 1].max)
+                return fail(status_t::INVALID_DRAWING, "vertices " + graph.labels[extents[i - 1].v] + " and "
+                    + graph.labels[extents[i].v] + " touch in " + line_name + ' ' + std::to_string(extents[i].line));
+        return status_t::OK;
+    };
+
+    const status_t status = check(&position_t::x, &position_t::y, true, "column");
+    if (status != status_t::OK)
+        return status;
+    return check(&position_t::y, &position_t::x, false, "row");
+}